@@ -3,6 +3,7 @@
 
 #include <dev/Console.h>
 #include <Memory.h>
+#include <Mutex.h>
 
 #include <dev/MasterBootRecord.h>
 
@@ -10,7 +11,7 @@ namespace valkyrie::kernel {
 
 StorageDevice::StorageDevice(const String &name, BlockDevice::Driver &driver,
                              size_t block_size)
-    : BlockDevice(name, driver, block_size), _partitions() {
+    : BlockDevice(name, driver, block_size), _partitions(), _io_lock() {
   auto buffer = make_unique<char[]>(block_size);
 
   // If the storage device's 0th sector is the MBR,
@@ -38,10 +39,12 @@ StorageDevice::StorageDevice(const String &name, BlockDevice::Driver &driver,
 }
 
 void StorageDevice::read_block(int block_index, void *buf) {
+  const LockGuard<Mutex> lock(_io_lock);
   _driver.read_block(block_index, buf);
 }
 
 void StorageDevice::write_block(int block_index, const void *buf) {
+  const LockGuard<Mutex> lock(_io_lock);
   _driver.write_block(block_index, buf);
 }
 
@@ -53,6 +53,7 @@
 #include <dev/Console.h>
 #include <driver/IO.h>
 #include <kernel/Exception.h>
+#include <kernel/Kernel.h>
 
 // Quoting from BCM2837-ARM-Peripherals.pdf (pg. 6)
 // ------------------------------------------------
@@ -86,7 +87,7 @@
 
 namespace valkyrie::kernel {
 
-MiniUART::MiniUART() {
+MiniUART::MiniUART() : _rx_buffer(), _rx_head(), _rx_tail(), _rx_wait_queue() {
   // Configure GPFSEL1 register to set both gpio14 and gpio15 to use ALT5.
   uint32_t reg = io::get<uint32_t>(GPFSEL1);
   reg &= ~(0b111 << 12);     // clear the 12~15th bits (gpio14)
@@ -106,18 +107,49 @@ MiniUART::MiniUART() {
   // Enable mini UART.
   io::put<uint32_t>(AUX_ENABLES, 1);      // enable mini UART and access to mini UART registers
   io::put<uint32_t>(AUX_MU_CNTL_REG, 0);  // disable tx/rx during configuration
-  io::put<uint32_t>(AUX_MU_IER_REG, 0b11);  // enable tx/rx interrupts
+  io::put<uint32_t>(AUX_MU_IER_REG, 0b01);  // enable rx interrupts
   io::put<uint32_t>(AUX_MU_LCR_REG, 3);     // sets the data size to 8 bit
   io::put<uint32_t>(AUX_MU_MCR_REG, 0);     // disable auto flow control
   io::put<uint32_t>(AUX_MU_BAUD_REG, 270);  // set baud rate to 115200
   io::put<uint32_t>(AUX_MU_IIR_REG, 1);     // FIFO empty, currently no irq pending
   io::put<uint32_t>(AUX_MU_CNTL_REG, 3);    // re-enable tx/rx
+
+  // Route the AUX interrupt to the ARM core.
+  io::put<uint32_t>(ENABLE_IRQS_1, MINI_UART_IRQ);
+}
+
+void MiniUART::handle_irq() {
+  // Drain the receive FIFO into the rx buffer. If the rx buffer is full,
+  // the oldest unread bytes are overwritten.
+  while (io::get<uint32_t>(AUX_MU_LSR_REG) & 1) {
+    _rx_buffer[_rx_tail] = io::get<uint8_t>(AUX_MU_IO_REG);
+    _rx_tail = (_rx_tail + 1) % MINI_UART_RX_BUFFER_SIZE;
+
+    if (_rx_tail == _rx_head) {
+      _rx_head = (_rx_head + 1) % MINI_UART_RX_BUFFER_SIZE;
+    }
+  }
+
+  _rx_wait_queue.wake_up_all();
 }
 
 uint8_t MiniUART::recv() {
-  while (!(io::get<uint32_t>(AUX_MU_LSR_REG) & 1))
-    ;
-  return io::get<uint8_t>(AUX_MU_IO_REG);
+  // Before the exception manager is activated (i.e., during early boot),
+  // there are no tasks to put to sleep, so we can only poll.
+  if (!exception::is_activated()) [[unlikely]] {
+    while (!(io::get<uint32_t>(AUX_MU_LSR_REG) & 1))
+      ;
+    return io::get<uint8_t>(AUX_MU_IO_REG);
+  }
+
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  // Sleep until the rx IRQ handler has put some bytes into the rx buffer.
+  _rx_wait_queue.sleep_on([this]() { return _rx_head != _rx_tail; });
+
+  uint8_t byte = _rx_buffer[_rx_head];
+  _rx_head = (_rx_head + 1) % MINI_UART_RX_BUFFER_SIZE;
+  return byte;
 }
 
 void MiniUART::send(const uint8_t byte) {
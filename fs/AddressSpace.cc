@@ -0,0 +1,82 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <fs/AddressSpace.h>
+
+#include <Algorithm.h>
+#include <CString.h>
+
+#include <fs/Vnode.h>
+#include <mm/MemoryManager.h>
+#include <mm/mmu.h>
+
+namespace valkyrie::kernel {
+
+AddressSpace::AddressSpace(Vnode &host) : _host(host), _pages(), _nr_pages() {}
+
+AddressSpace::~AddressSpace() {
+  invalidate();
+}
+
+void *AddressSpace::get_page(size_t index) {
+  if (void *page = _pages.get(index)) [[likely]] {
+    return page;
+  }
+
+  void *page = get_free_page(/*physical=*/true);
+
+  if (!page) [[unlikely]] {
+    return nullptr;
+  }
+
+  MemoryManager::the().inc_page_ref_count(page);
+
+  if (!_host.read_page(index, page) || !_pages.insert(index, page)) [[unlikely]] {
+    put_page(page);
+    return nullptr;
+  }
+
+  _nr_pages++;
+  return page;
+}
+
+size_t AddressSpace::read_at(off_t offset, void *buf, size_t len) {
+  const off_t size = _host.get_size();
+
+  if (offset >= size) {
+    return 0;
+  }
+
+  len = min(len, static_cast<size_t>(size - offset));
+
+  auto dest = reinterpret_cast<char *>(buf);
+  size_t nr_bytes_read = 0;
+
+  while (nr_bytes_read < len) {
+    const size_t page_offset = offset % PAGE_SIZE;
+    const size_t chunk_size = min(len - nr_bytes_read, PAGE_SIZE - page_offset);
+    auto page = reinterpret_cast<const char *>(get_page(offset / PAGE_SIZE));
+
+    if (!page) [[unlikely]] {
+      break;
+    }
+
+    memcpy(dest + nr_bytes_read, page + page_offset, chunk_size);
+    nr_bytes_read += chunk_size;
+    offset += chunk_size;
+  }
+
+  return nr_bytes_read;
+}
+
+void AddressSpace::invalidate() {
+  _pages.for_each([](size_t, void *page) { put_page(page); });
+  _pages.clear();
+  _nr_pages = 0;
+}
+
+void AddressSpace::put_page(void *page) {
+  if (MemoryManager::the().dec_page_ref_count(page) == 0) {
+    kfree(page);
+  }
+}
+
+}  // namespace valkyrie::kernel
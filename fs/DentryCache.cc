@@ -0,0 +1,135 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <fs/DentryCache.h>
+
+#include <Hash.h>
+#include <Mutex.h>
+
+namespace valkyrie::kernel {
+
+namespace {
+
+// Dropping the last reference to a vnode may free a lot of memory,
+// so the dentries are only deleted after the lock is released.
+template <typename List>
+void delete_dentries(List &dentries) {
+  while (!dentries.empty()) {
+    auto &dentry = dentries.front();
+    dentries.pop_front();
+    delete &dentry;
+  }
+}
+
+}  // namespace
+
+DentryCache::DentryCache() : _lock(), _buckets(), _lru(), _size() {}
+
+DentryCache::~DentryCache() {
+  invalidate_all();
+}
+
+bool DentryCache::lookup(const Vnode &dir, StringView name, size_t name_hash,
+                         SharedPtr<Vnode> &out) {
+  const LockGuard<SpinLock> lock(_lock);
+
+  Dentry *dentry = find(dir, name, name_hash);
+
+  if (!dentry) {
+    return false;
+  }
+
+  // Move it to the most recently used end.
+  LRUList::remove(*dentry);
+  _lru.push_back(*dentry);
+
+  out = dentry->vnode;
+  return true;
+}
+
+void DentryCache::insert(SharedPtr<Vnode> dir, StringView name, size_t name_hash,
+                         SharedPtr<Vnode> child) {
+  auto new_dentry = new Dentry(move(dir), name, name_hash, move(child));
+  LRUList victims;
+
+  if (!new_dentry) [[unlikely]] {
+    return;
+  }
+
+  {
+    const LockGuard<SpinLock> lock(_lock);
+
+    if (Dentry *old_dentry = find(*new_dentry->dir, name, name_hash)) {
+      unlink(*old_dentry);
+      victims.push_back(*old_dentry);
+    }
+
+    while (_size >= DCACHE_CAPACITY) {
+      Dentry &lru_dentry = _lru.front();
+      unlink(lru_dentry);
+      victims.push_back(lru_dentry);
+    }
+
+    _buckets[bucket_of(*new_dentry->dir, name_hash)].push_back(*new_dentry);
+    _lru.push_back(*new_dentry);
+    _size++;
+  }
+
+  delete_dentries(victims);
+}
+
+void DentryCache::invalidate(const Vnode &dir, StringView name) {
+  const size_t name_hash = Hash<StringView>{}(name);
+  LRUList victims;
+  {
+    const LockGuard<SpinLock> lock(_lock);
+
+    if (Dentry *dentry = find(dir, name, name_hash)) {
+      unlink(*dentry);
+      victims.push_back(*dentry);
+    }
+  }
+
+  delete_dentries(victims);
+}
+
+void DentryCache::invalidate_all() {
+  LRUList victims;
+  {
+    const LockGuard<SpinLock> lock(_lock);
+
+    while (!_lru.empty()) {
+      Dentry &dentry = _lru.front();
+      unlink(dentry);
+      victims.push_back(dentry);
+    }
+  }
+
+  delete_dentries(victims);
+}
+
+size_t DentryCache::bucket_of(const Vnode &dir, size_t name_hash) {
+  // The low bits of `&dir` are always zero, since a Vnode is 8-byte aligned.
+  const size_t dir_hash = reinterpret_cast<size_t>(&dir) >> 3;
+  return (dir_hash * 31 + name_hash) % DCACHE_HASH_SIZE;
+}
+
+DentryCache::Dentry *DentryCache::find(const Vnode &dir, StringView name, size_t name_hash) {
+  Dentry *ret = nullptr;
+
+  // Only compare the names if everything else matches.
+  _buckets[bucket_of(dir, name_hash)].for_each([&](Dentry &dentry) {
+    if (dentry.dir.get() == &dir && dentry.name_hash == name_hash &&
+        StringView(dentry.name.c_str(), dentry.name_size) == name) {
+      ret = &dentry;
+    }
+  });
+
+  return ret;
+}
+
+void DentryCache::unlink(Dentry &dentry) {
+  HashList::remove(dentry);
+  LRUList::remove(dentry);
+  _size--;
+}
+
+}  // namespace valkyrie::kernel
@@ -4,8 +4,14 @@
 #include <List.h>
 #include <Math.h>
 #include <Memory.h>
+#include <Mutex.h>
+#include <SpinLock.h>
 
 #include <kernel/Kernel.h>
+#include <proc/Preempt.h>
+
+// cluster_read() reads a single sector, so a cluster is assumed to be 512 bytes.
+#define FAT32_CLUSTER_SIZE 512UL
 
 #define FAT32_EOC_MIN 0x0ffffff8
 #define FAT32_EOC_MAX 0x0fffffff
@@ -26,7 +32,12 @@ FAT32::FAT32(DiskPartition &disk_partition)
       _metadata(disk_partition),
       _nr_fat_entries_per_sector(_metadata.bytes_per_sector / sizeof(uint32_t)),
       _root_inode(make_shared<FAT32Inode>(*this, "/", _metadata.root_cluster, FAT32_EOC_MAX, 0,
-                                          0, S_IFDIR, 0, 0)) {}
+                                          0, S_IFDIR, 0, 0)),
+      _inode_cache_lock(),
+      _inode_cache(),
+      _rwsem() {
+  cache_inode(_root_inode);
+}
 
 uint32_t FAT32::fat_read(const uint32_t fat_entry_index) const {
   if (fat_entry_index >= nr_single_fat_entries()) [[unlikely]] {
@@ -62,6 +73,7 @@ uint32_t FAT32::fat_find_free_cluster() const {
   for (uint32_t index = fat0_sector_index(); index < fat1_sector_index(); index++) {
     char buf[512];
     _disk_partition.read_block(index, buf);
+    cond_resched();
 
     for (int i = 0; i < _nr_fat_entries_per_sector; i++) {
       if (*(reinterpret_cast<uint32_t *>(buf) + i) == 0) {
@@ -190,6 +202,66 @@ SharedPtr<Vnode> FAT32::get_root_vnode() {
   return _root_inode;
 }
 
+size_t FAT32::get_nr_disk_reads() {
+  return _nr_disk_reads.load(MemoryOrder::RELAXED);
+}
+
+size_t FAT32::get_nr_irqs_off_disk_reads() {
+  return _nr_irqs_off_disk_reads.load(MemoryOrder::RELAXED);
+}
+
+SharedPtr<FAT32Inode> FAT32::get_inode(const DirectoryEntryView &dentry_view) {
+  const mode_t mode = (dentry_view.dentry.attributes & ATTR_DIRECTORY) ? S_IFDIR : S_IFREG;
+  const uint32_t first_cluster_number = dentry_view.dentry.get_first_cluster_number();
+
+  // The ".." of a top-level directory refers to the root directory by
+  // a first cluster number of 0 (or, by some tools, by root_cluster), and
+  // must come out as the root inode rather than an unrelated copy of it.
+  if (mode == S_IFDIR &&
+      (!first_cluster_number || first_cluster_number == _metadata.root_cluster)) {
+    return _root_inode;
+  }
+
+  const uint64_t key =
+      FAT32Inode::get_key(mode, first_cluster_number, dentry_view.parent_cluster_number,
+                          dentry_view.parent_cluster_offset);
+
+  const LockGuard<SpinLock> lock(_inode_cache_lock);
+  auto &bucket = _inode_cache[key % FAT32_INODE_CACHE_SIZE];
+  SharedPtr<FAT32Inode> ret;
+
+  bucket.remove_if(
+      [&ret, key](auto &weak_inode) {
+        SharedPtr<FAT32Inode> inode = weak_inode.lock();
+
+        if (!inode) {
+          return true;
+        }
+
+        if (!ret && inode->get_key() == key) {
+          ret = move(inode);
+        }
+        return false;
+      },
+      /*check_all=*/true);
+
+  if (!ret) {
+    ret = make_shared<FAT32Inode>(*this, dentry_view.name, first_cluster_number,
+                                  dentry_view.parent_cluster_number,
+                                  dentry_view.parent_cluster_offset, dentry_view.dentry.size,
+                                  mode, 0, 0);
+    bucket.push_back(WeakPtr<FAT32Inode>(ret));
+  }
+
+  return ret;
+}
+
+void FAT32::cache_inode(const SharedPtr<FAT32Inode> &inode) {
+  const LockGuard<SpinLock> lock(_inode_cache_lock);
+
+  _inode_cache[inode->get_key() % FAT32_INODE_CACHE_SIZE].push_back(WeakPtr<FAT32Inode>(inode));
+}
+
 String FAT32::FilenameEntry::get_filename() const {
   size_t len = sizeof(filename_part1) + sizeof(filename_part2) + sizeof(filename_part3);
 
@@ -230,10 +302,14 @@ FAT32Inode::FAT32Inode(FAT32 &fs, const String &name, uint32_t first_cluster_num
       _first_cluster_number(first_cluster_number),
       _parent_cluster_number(parent_cluster_number),
       _parent_cluster_offset(parent_cluster_offset),
-      _content() {}
+      _content(),
+      _cursor_cluster_index(),
+      _cursor_cluster_number() {}
 
 SharedPtr<Vnode> FAT32Inode::create_child(const String &name, const char *content, off_t size,
                                           mode_t mode, uid_t uid, gid_t gid) {
+  const LockGuard<RWSemaphore> lock(_fs._rwsem);
+
   if (!is_directory()) [[unlikely]] {
     printk("fat32: create_child() called on a non-directory item\n");
     return nullptr;
@@ -446,6 +522,7 @@ SharedPtr<Vnode> FAT32Inode::create_child(const String &name, const char *conten
           inode->_first_cluster_number = free_cluster_number;
         }
 
+        _fs.cache_inode(inode);
         return inode;
       }
     }
@@ -457,6 +534,8 @@ SharedPtr<Vnode> FAT32Inode::create_child(const String &name, const char *conten
 }
 
 SharedPtr<Vnode> FAT32Inode::get_child(const String &name) {
+  const SharedLockGuard<RWSemaphore> lock(_fs._rwsem);
+
   if (is_root_vnode() && (name == "." || name == "..")) {
     return _fs._root_inode;
   }
@@ -465,6 +544,8 @@ SharedPtr<Vnode> FAT32Inode::get_child(const String &name) {
 }
 
 SharedPtr<Vnode> FAT32Inode::get_ith_child(size_t i) {
+  const SharedLockGuard<RWSemaphore> lock(_fs._rwsem);
+
   // In FAT32, the top-level directory doesn't have
   // "." and "..". In order to comply with the interface of VFS
   // which mandates that the top-level directory should
@@ -481,6 +562,8 @@ SharedPtr<Vnode> FAT32Inode::get_ith_child(size_t i) {
 }
 
 size_t FAT32Inode::get_children_count() const {
+  const SharedLockGuard<RWSemaphore> lock(_fs._rwsem);
+
   size_t ret = 0;
 
   if (is_root_vnode()) {
@@ -507,11 +590,19 @@ String FAT32Inode::get_name() const {
 }
 
 char *FAT32Inode::get_content() {
+  const SharedLockGuard<RWSemaphore> lock(_fs._rwsem);
+
   if (!is_regular_file()) [[unlikely]] {
     printk("fat32: get_content() is called on a non-regular-file item\n");
     return nullptr;
   }
 
+  // The inode is the same on every lookup, so the content read by an earlier
+  // call is still here, unless set_content() has been called since.
+  if (_content) {
+    return _content.get();
+  }
+
   _content = make_unique<char[]>(round_up_to_multiple_of_n(_size, 512));
 
   int i = 0;
@@ -523,6 +614,8 @@ char *FAT32Inode::get_content() {
 }
 
 void FAT32Inode::set_content(UniquePtr<char[]> content, off_t new_size) {
+  const LockGuard<RWSemaphore> lock(_fs._rwsem);
+
   off_t buf_size = round_up_to_multiple_of_n(new_size, 512);
 
   if (!_first_cluster_number) {
@@ -557,6 +650,70 @@ void FAT32Inode::set_content(UniquePtr<char[]> content, off_t new_size) {
 
   _content.reset();  // we have written it to the disk, so we don't need it now.
   _size = new_size;
+  _cursor_cluster_number = 0;
+}
+
+size_t FAT32Inode::read_at(off_t offset, void *buf, size_t len) {
+  const SharedLockGuard<RWSemaphore> lock(_fs._rwsem);
+
+  if (!is_regular_file()) [[unlikely]] {
+    printk("fat32: read_at() is called on a non-regular-file item\n");
+    return 0;
+  }
+
+  if (offset >= _size) {
+    return 0;
+  }
+
+  len = min(len, static_cast<size_t>(_size - offset));
+
+  // The whole file may have been read by get_content() already.
+  if (_content) {
+    memcpy(buf, _content.get() + offset, len);
+    return len;
+  }
+
+  // Reading a chain of clusters polls the SD card for a long time,
+  // which must not be done with IRQs masked if we can help it.
+  FAT32::_nr_disk_reads.fetch_add(1, MemoryOrder::RELAXED);
+
+  if (exception::are_irqs_disabled()) [[unlikely]] {
+    FAT32::_nr_irqs_off_disk_reads.fetch_add(1, MemoryOrder::RELAXED);
+  }
+
+  // Only read the clusters within [offset, offset + len). A cluster which
+  // is wholly requested goes straight into `buf`, while the partial ones at
+  // both ends go through a bounce buffer.
+  auto dest = reinterpret_cast<char *>(buf);
+  uint32_t cluster_index = offset / FAT32_CLUSTER_SIZE;
+  size_t cluster_offset = offset % FAT32_CLUSTER_SIZE;
+  size_t nr_bytes_read = 0;
+
+  for (uint32_t n = get_ith_cluster_number(cluster_index); !FAT32_IS_EOC(n);) {
+    const size_t chunk_size = min(len - nr_bytes_read, FAT32_CLUSTER_SIZE - cluster_offset);
+
+    if (chunk_size == FAT32_CLUSTER_SIZE) {
+      _fs.cluster_read(n, dest + nr_bytes_read);
+    } else {
+      char cluster[FAT32_CLUSTER_SIZE];
+      _fs.cluster_read(n, cluster);
+      memcpy(dest + nr_bytes_read, cluster + cluster_offset, chunk_size);
+    }
+
+    _cursor_cluster_index = cluster_index;
+    _cursor_cluster_number = n;
+    nr_bytes_read += chunk_size;
+    cluster_offset = 0;
+
+    if (nr_bytes_read == len) {
+      break;
+    }
+
+    n = _fs.fat_read(n);
+    cluster_index++;
+  }
+
+  return nr_bytes_read;
 }
 
 size_t FAT32Inode::hash_code() const {
@@ -564,7 +721,18 @@ size_t FAT32Inode::hash_code() const {
 }
 
 bool FAT32Inode::is_root_vnode() const {
-  return hash_code() == _fs._root_inode->hash_code();
+  return this == _fs._root_inode.get();
+}
+
+uint64_t FAT32Inode::get_key(mode_t mode, uint32_t first_cluster_number,
+                             uint32_t parent_cluster_number, uint32_t parent_cluster_offset) {
+  // Cluster numbers only have 28 bits, so bit 63 tells the two kinds of keys apart.
+  if (Vnode::is_directory(mode)) {
+    return first_cluster_number;
+  }
+
+  return (1ULL << 63) | (static_cast<uint64_t>(parent_cluster_number) << 32) |
+      parent_cluster_offset;
 }
 
 uint32_t FAT32Inode::dir_first_cluster_number() const {
@@ -575,6 +743,27 @@ uint32_t FAT32Inode::dir_first_cluster_number() const {
                                : _fs._root_inode->_first_cluster_number;
 }
 
+uint32_t FAT32Inode::get_ith_cluster_number(uint32_t i) {
+  uint32_t n = _first_cluster_number;
+  uint32_t index = 0;
+
+  if (!n) {
+    return FAT32_EOC_MAX;
+  }
+
+  // Start from where the last read_at() has left off, if it's not past `i`.
+  if (_cursor_cluster_number && _cursor_cluster_index <= i) {
+    n = _cursor_cluster_number;
+    index = _cursor_cluster_index;
+  }
+
+  for (; index < i && !FAT32_IS_EOC(n); index++) {
+    n = _fs.fat_read(n);
+  }
+
+  return n;
+}
+
 void FAT32Inode::allocate_first_cluster() const {
   // Check if it already has the first cluster.
   if (_first_cluster_number) [[unlikely]] {
@@ -627,13 +816,7 @@ SharedPtr<FAT32Inode> FAT32Inode::find_child_if(
     return nullptr;
   }
 
-  const FAT32::DirectoryEntryView &dentry_view = __dentry_view;
-  mode_t mode = (dentry_view.dentry.attributes & ATTR_DIRECTORY) ? S_IFDIR : S_IFREG;
-
-  return make_shared<FAT32Inode>(
-      _fs, dentry_view.name, dentry_view.dentry.get_first_cluster_number(),
-      dentry_view.parent_cluster_number, dentry_view.parent_cluster_offset,
-      dentry_view.dentry.size, mode, 0, 0);
+  return _fs.get_inode(__dentry_view);
 }
 
 void FAT32Inode::iterate_children(Function<bool(const FAT32::DirectoryEntryView &)> f) const {
@@ -5,10 +5,14 @@
 #include <CString.h>
 
 #include <dev/Console.h>
+#include <fs/FAT32.h>
+#include <fs/Readahead.h>
 #include <fs/Stat.h>
 #include <fs/VirtualFileSystem.h>
 #include <kernel/Kernel.h>
+#include <kernel/TimerMultiplexer.h>
 #include <mm/MemoryManager.h>
+#include <proc/TaskScheduler.h>
 
 namespace valkyrie::kernel {
 
@@ -31,6 +35,9 @@ ProcFS::ProcFS() : _root_inode(make_shared<ProcFSInode>(*this, nullptr, "/", S_I
   _root_inode->add_child(make_shared<HelloInode>(*this));
   _root_inode->add_child(make_shared<BuddyInfoInode>(*this));
   _root_inode->add_child(make_shared<SlobInfoInode>(*this));
+  _root_inode->add_child(make_shared<StatInode>(*this));
+  _root_inode->add_child(make_shared<SchedStatInode>(*this));
+  _root_inode->add_child(make_shared<ReadaheadInode>(*this));
 }
 
 SharedPtr<Vnode> ProcFS::get_root_vnode() {
@@ -260,6 +267,64 @@ char *SlobInfoInode::get_content() {
   return _content.get();
 }
 
+char *StatInode::get_content() {
+  const auto &sched = TaskScheduler::the();
+  const auto &timer = TimerMultiplexer::the().get_arm_core_timer();
+
+  constexpr size_t len = 256;
+  _content = make_unique<char[]>(len);
+
+  sprintf(_content.get(),
+          "uptime_ns: %lu\n"
+          "idle_ns: %lu\n"
+          "idle_entries: %lu\n"
+          "jiffies: %lu\n"
+          "fat32_disk_reads: %lu\n"
+          "fat32_irqs_off_disk_reads: %lu\n",
+          sched.get_uptime_ns(), sched.get_idle_time_ns(), sched.get_nr_idle_entries(),
+          timer.get_jiffies(), FAT32::get_nr_disk_reads(),
+          FAT32::get_nr_irqs_off_disk_reads());
+
+  _size = strlen(_content.get());
+  return _content.get();
+}
+
+char *SchedStatInode::get_content() {
+  const auto &sched = TaskScheduler::the();
+
+  constexpr size_t len = 128;
+  _content = make_unique<char[]>(len);
+
+  sprintf(_content.get(),
+          "rt_wakeups: %lu\n"
+          "rt_wakeup_latency_last_ns: %lu\n"
+          "rt_wakeup_latency_max_ns: %lu\n"
+          "kernel_preemptions: %lu\n",
+          sched.get_nr_rt_wakeups(), sched.get_last_rt_wakeup_latency_ns(),
+          sched.get_max_rt_wakeup_latency_ns(), sched.get_nr_kernel_preemptions());
+
+  _size = strlen(_content.get());
+  return _content.get();
+}
+
+char *ReadaheadInode::get_content() {
+  const auto &readahead = Readahead::the();
+
+  constexpr size_t len = 128;
+  _content = make_unique<char[]>(len);
+
+  sprintf(_content.get(),
+          "hits: %lu\n"
+          "misses: %lu\n"
+          "pages_read_ahead: %lu\n"
+          "requests_dropped: %lu\n",
+          readahead.get_nr_hits(), readahead.get_nr_misses(),
+          readahead.get_nr_pages_read_ahead(), readahead.get_nr_requests_dropped());
+
+  _size = strlen(_content.get());
+  return _content.get();
+}
+
 char *TaskStatusInode::get_content() {
   pid_t pid = 0;
   Task *task = nullptr;
@@ -284,8 +349,11 @@ char *TaskStatusInode::get_content() {
   sprintf(_content.get(),
           "Name: %s\n"
           "State: %d\n"
-          "Pid: %d\n",
-          task->get_name(), task->get_state(), task->get_pid());
+          "Pid: %d\n"
+          "Policy: %d\n"
+          "Priority: %d\n",
+          task->get_name(), task->get_state(), task->get_pid(), task->get_policy(),
+          task->get_rt_priority());
 
   _size = len;
   return _content.get();
@@ -0,0 +1,159 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <fs/Readahead.h>
+
+#include <Algorithm.h>
+#include <Mutex.h>
+
+#include <fs/File.h>
+#include <fs/Vnode.h>
+#include <kernel/Kernel.h>
+#include <mm/mmu.h>
+
+namespace valkyrie::kernel {
+
+Readahead::Readahead()
+    : _requests(),
+      _wait_queue(),
+      _nr_hits(),
+      _nr_misses(),
+      _nr_pages_read_ahead(),
+      _nr_requests_dropped() {}
+
+void Readahead::on_read(File &file, size_t len) {
+  Vnode &vnode = *file.vnode;
+  const size_t size = static_cast<size_t>(vnode.get_size());
+
+  if (file.pos >= size || len == 0) {
+    return;
+  }
+
+  len = min(len, size - file.pos);
+
+  const size_t first = file.pos / PAGE_SIZE;
+  const size_t last = (file.pos + len - 1) / PAGE_SIZE;
+  const size_t nr_file_pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+  size_t nr_hits = 0;
+
+  for (size_t i = first; i <= last; i++) {
+    nr_hits += vnode.get_mapping().contains(i);
+  }
+
+  _nr_hits.fetch_add(nr_hits, MemoryOrder::RELAXED);
+  _nr_misses.fetch_add(last - first + 1 - nr_hits, MemoryOrder::RELAXED);
+
+  // A read of the page where the previous one ended, or of the page after
+  // it, is sequential. So is the first read of a file, if it starts at 0,
+  // since `prev_index + 1` wraps around to 0.
+  ReadaheadState &ra = file.ra;
+  const bool is_sequential = first == ra.prev_index || first == ra.prev_index + 1;
+
+  ra.prev_index = last;
+
+  if (!is_sequential) {
+    ra.size = max(ra.size / 2, static_cast<size_t>(RA_MIN_PAGES));
+    ra.mark = ReadaheadState::npos;
+    return;
+  }
+
+  if (ra.mark != ReadaheadState::npos && last < ra.mark) {
+    return;
+  }
+
+  size_t start;
+  size_t nr_pages;
+
+  if (ra.mark == ReadaheadState::npos) {
+    start = last + 1;
+    nr_pages = ra.size;
+  } else {
+    // The reader has entered the window in flight, or a large read has
+    // skipped past it, so queue the one after it.
+    start = max(ra.start + ra.size, last + 1);
+    nr_pages = min(ra.size * 2, static_cast<size_t>(RA_MAX_PAGES));
+  }
+
+  ra.start = start;
+  ra.size = nr_pages;
+  ra.mark = start;
+
+  if (start < nr_file_pages) {
+    submit(file.vnode, start, min(nr_pages, nr_file_pages - start));
+  }
+}
+
+size_t Readahead::get_nr_hits() const {
+  return _nr_hits.load(MemoryOrder::RELAXED);
+}
+
+size_t Readahead::get_nr_misses() const {
+  return _nr_misses.load(MemoryOrder::RELAXED);
+}
+
+size_t Readahead::get_nr_pages_read_ahead() const {
+  return _nr_pages_read_ahead.load(MemoryOrder::RELAXED);
+}
+
+size_t Readahead::get_nr_requests_dropped() const {
+  return _nr_requests_dropped.load(MemoryOrder::RELAXED);
+}
+
+void Readahead::submit(SharedPtr<Vnode> vnode, size_t start, size_t nr_pages) {
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  // Readahead is only a hint, so a busy kreadaheadd just drops it,
+  // and the reader reads the pages in by itself.
+  if (_requests.size() >= NR_READAHEAD_REQUESTS) [[unlikely]] {
+    _nr_requests_dropped.fetch_add(1, MemoryOrder::RELAXED);
+    return;
+  }
+
+  _requests.push_back(Request{move(vnode), start, nr_pages});
+  _wait_queue.wake_up();
+}
+
+void Readahead::process(const Request &request) {
+  Vnode &vnode = *request.vnode;
+
+  // The vnode lock is taken for one page at a time, so that the reader
+  // can consume the pages that are already in while we read the rest.
+  for (size_t i = 0; i < request.nr_pages; i++) {
+    const LockGuard<Mutex> lock(vnode.get_lock());
+    const size_t index = request.start + i;
+
+    // The file may have been truncated since the request was queued.
+    if (index * PAGE_SIZE >= static_cast<size_t>(vnode.get_size())) {
+      break;
+    }
+
+    if (vnode.get_mapping().contains(index)) {
+      continue;
+    }
+
+    if (!vnode.get_mapping().get_page(index)) [[unlikely]] {
+      break;
+    }
+
+    _nr_pages_read_ahead.fetch_add(1, MemoryOrder::RELAXED);
+  }
+}
+
+[[noreturn]] void start_kreadaheadd() {
+  Readahead &readahead = Readahead::the();
+
+  while (true) {
+    Readahead::Request request{};
+    {
+      const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+      readahead._wait_queue.sleep_on([&readahead]() { return !readahead._requests.empty(); });
+      request = move(readahead._requests.front());
+      readahead._requests.pop_front();
+    }
+
+    // `request` holds a reference to the vnode, which is dropped
+    // once the pages are in, outside Kernel::mutex.
+    readahead.process(request);
+  }
+}
+
+}  // namespace valkyrie::kernel
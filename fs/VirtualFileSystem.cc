@@ -4,13 +4,17 @@
 #include <Algorithm.h>
 #include <Hash.h>
 #include <List.h>
+#include <SpinLock.h>
 #include <String.h>
+#include <StringView.h>
 
 #include <driver/SDCardDriver.h>
 #include <fs/CPIOArchive.h>
 #include <fs/DirectoryEntry.h>
 #include <fs/File.h>
+#include <fs/PathWalker.h>
 #include <fs/ProcFS.h>
+#include <fs/Readahead.h>
 #include <fs/Stat.h>
 #include <fs/TmpFS.h>
 #include <fs/Vnode.h>
@@ -19,13 +23,42 @@
 
 namespace valkyrie::kernel {
 
+namespace {
+
+// Publishes a modified copy of the list referred to by `ptr`, and frees
+// the old version after a grace period. The caller serializes the writers.
+template <typename T, typename F>
+void rcu_update(RCUPointer<List<T>> &ptr, F &&modify) {
+  List<T> *old_list = ptr.read();
+  auto new_list = new List<T>();
+
+  for (auto &entry : *old_list) {
+    new_list->push_back(entry);
+  }
+
+  modify(*new_list);
+
+  old_list = ptr.publish(new_list);
+  RCU::the().synchronize();
+  delete old_list;
+}
+
+}  // namespace
+
 VFS::VFS()
     : _next_inode_idx(),
       _next_dev_major(1),
-      _mounts(),
-      _opened_files(),
+      _mounts_update_lock(),
+      _mounts(new MountTable()),
       _storage_devices(),
-      _registered_devices() {}
+      _devices_update_lock(),
+      _registered_devices(new DeviceTable()),
+      _dcache(),
+      _mount_hash() {
+  for (auto &bucket : _mount_hash) {
+    static_cast<void>(bucket.publish(new MountTable()));
+  }
+}
 
 void VFS::mount_rootfs() {
   // TODO: currently it only supports SD card.
@@ -36,11 +69,15 @@ void VFS::mount_rootfs() {
 }
 
 void VFS::mount_rootfs(SharedPtr<FileSystem> fs) {
-  if (!_mounts.empty()) [[unlikely]] {
+  const LockGuard<Mutex> lock(_mounts_update_lock);
+
+  if (!_mounts.read()->empty()) [[unlikely]] {
     Kernel::panic("VFS::mount_rootfs: root filesystem is already mounted!\n");
   }
 
-  _mounts.push_back(make_unique<Mount>(fs, fs->get_root_vnode(), fs->get_root_vnode()));
+  rcu_update(_mounts, [&fs](auto &mounts) {
+    mounts.push_back(make_shared<Mount>(fs, fs->get_root_vnode(), fs->get_root_vnode()));
+  });
 }
 
 void VFS::mount_rootfs(SharedPtr<FileSystem> fs, const CPIOArchive &archive) {
@@ -93,16 +130,10 @@ void VFS::populate_devtmpfs() {
   }
 }
 
-SharedPtr<Vnode> VFS::create(const String &pathname, const char *content, size_t size,
+SharedPtr<Vnode> VFS::create(StringView pathname, const char *content, size_t size,
                              mode_t mode, uid_t uid, gid_t gid) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-
-  if (pathname == "." || pathname == "..") {
-    return nullptr;
-  }
-
   // Check if the parent directory entry exists.
-  String basename;
+  StringView basename;
   SharedPtr<Vnode> parent;
   SharedPtr<Vnode> target = resolve_path(pathname, &parent, &basename);
 
@@ -119,76 +150,60 @@ SharedPtr<Vnode> VFS::create(const String &pathname, const char *content, size_t
     return nullptr;
   }
 
-  return parent->create_child(basename, content, size, mode, 0, 0);
-}
+  // ".." always exists, and "." never makes it here (see PathWalker).
+  if (basename == "..") [[unlikely]] {
+    return nullptr;
+  }
 
-SharedPtr<File> VFS::open(const String &pathname, int options) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  // Unlike a lookup, creating a file allocates anyway.
+  const String name = basename.to_string();
+  const LockGuard<Mutex> lock(parent->get_lock());
 
-  // Lookup pathname from the root vnode.
-  SharedPtr<Vnode> target = resolve_path(pathname);
+  // Someone may have created it after we've looked it up.
+  if (parent->get_child(name)) {
+    return nullptr;
+  }
 
-  // Check if this file has already been opened by any other process.
-  auto it = _opened_files.find_if(
-      [&target](const auto &f) { return f->vnode.get() == target.get(); });
+  SharedPtr<Vnode> child = parent->create_child(name, content, size, mode, 0, 0);
 
-  // If yes, then we can return its file handle now.
-  if (it != _opened_files.end()) {
-    return *it;
+  // Replace the negative dentry, if any.
+  if (child && parent->is_lookup_cacheable()) {
+    _dcache.insert(parent, basename, Hash<StringView>{}(basename), child);
   }
 
-  // Otherwise, the file has not been opened by any process yet.
-  // If the file exists, then we will open it now.
-  if (target) {
-    _opened_files.push_back(make_shared<File>(get_rootfs(), target, options));
-    return _opened_files.back();
+  return child;
+}
+
+SharedPtr<File> VFS::open(StringView pathname, int options) {
+  // Lookup pathname from the root vnode.
+  SharedPtr<Vnode> target = resolve_path(pathname);
+
+  // Okay, so the user wants to create this file...
+  if (!target && (options & O_CREAT)) {
+    target = create(pathname, nullptr, 0, S_IFREG, 0, 0);
   }
 
   // File doesn't exist...
-  // We should check if `O_CREAT` is sepcified in options.
-  if (!(options & O_CREAT)) {
+  if (!target) {
     return nullptr;
   }
 
-  // Okay, so the user wants to create this file...
-  target = create(pathname, nullptr, 0, S_IFREG, 0, 0);
-  _opened_files.push_back(make_shared<File>(get_rootfs(), target, options));
-  return _opened_files.back();
+  // Each open() creates a new open file description with its own offset,
+  // even if the file has been opened before.
+  return make_shared<File>(get_rootfs(), move(target), options);
 }
 
 int VFS::close(SharedPtr<File> file) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-
   if (!file) [[unlikely]] {
     return -1;
   }
 
-  auto it = _opened_files.find_if([file](const auto &f) { return f->vnode == file->vnode; });
-
-  // `file` != nullptr but the file is not opened.
-  // The user is probably trying to close an unopened file?
-  if (it == _opened_files.end()) [[unlikely]] {
-    return -1;
-  }
-
-  file->pos = 0;
-
-  // Why should we release this file from the system-wide file table
-  // when file.use_count == 3?
-  //
-  // 1. `file` != nullptr
-  // 2. `_opened_files` contains one instance
-  // 3. sys_close contains one instance
-  if (file.use_count() <= 3) {
-    _opened_files.remove_if([file](const auto &f) { return f->vnode == file->vnode; });
-  }
-
+  // The open file description is freed along with its last reference,
+  // which other fds (e.g., in a forked child) may still hold.
   return 0;
 }
 
 int VFS::write(SharedPtr<File> file, const void *buf, size_t len) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-
   // 1. write len byte from buf to the opened file.
   // 2. return written size or error code if an error occurs.
   if (!file) [[unlikely]] {
@@ -196,9 +211,16 @@ int VFS::write(SharedPtr<File> file, const void *buf, size_t len) {
   }
 
   if (file->vnode->is_regular_file()) {
+    const LockGuard<Mutex> lock(file->vnode->get_lock());
+
     auto new_content = make_unique<char[]>(len);
     memcpy(new_content.get(), buf, len);
     file->vnode->set_content(move(new_content), len);
+    file->pos += len;
+
+    // The filesystem has the new content now, so the cached pages are stale.
+    // The ones that are still mapped live on as private copies.
+    file->vnode->get_mapping().invalidate();
 
   } else if (file->vnode->is_character_device()) {
     auto cdev = static_cast<CharacterDevice *>(find_registered_device(file->vnode->get_dev()));
@@ -217,29 +239,32 @@ int VFS::write(SharedPtr<File> file, const void *buf, size_t len) {
     return -1;
   }
 
-  file->pos += len;
   return len;
 }
 
 int VFS::read(SharedPtr<File> file, void *buf, size_t len) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-
   // 1. read min(len, readable file data size) byte to buf from the opened file.
   // 2. return read size or error code if an error occurs.
   if (!file) [[unlikely]] {
     return -1;
   }
 
+  // Character devices may block for a long time (e.g., waiting for input),
+  // so the vnode lock is only held for regular files and directories.
   if (file->vnode->is_regular_file()) {
-    char *content = file->vnode->get_content();
-    size_t size = file->vnode->get_size();
-    size_t readable_size = size - file->pos;
+    const LockGuard<Mutex> lock(file->vnode->get_lock());
 
-    len = min(len, readable_size);
-    memcpy(buf, content + file->pos, len);
+    if (file->vnode->is_page_cacheable()) {
+      Readahead::the().on_read(*file, len);
+      len = file->vnode->get_mapping().read_at(file->pos, buf, len);
+    } else {
+      len = file->vnode->read_at(file->pos, buf, len);
+    }
     file->pos += len;
 
   } else if (file->vnode->is_directory()) {
+    const LockGuard<Mutex> lock(file->vnode->get_lock());
+
     // Here `file->pos` is used as the index of the last iterated child.
     // FIXME: lol this is fooking slow, but i'm too busy this week...
     if (file->pos >= file->vnode->get_children_count()) {
@@ -290,9 +315,7 @@ int VFS::read(SharedPtr<File> file, void *buf, size_t len) {
   return len;
 }
 
-int VFS::access(const String &pathname, int options) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-
+int VFS::access(StringView pathname, int options) {
   // Check user's permission for a file.
   // FIXME: currently it simply checks if the file exists...
   SharedPtr<Vnode> target = resolve_path(pathname);
@@ -305,8 +328,6 @@ int VFS::access(const String &pathname, int options) {
 }
 
 int VFS::mkdir(const String &pathname) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-
   if (create(pathname, nullptr, 0, S_IFDIR, 0, 0)) {
     return 0;
   }
@@ -314,18 +335,14 @@ int VFS::mkdir(const String &pathname) {
 }
 
 int VFS::rmdir(const String &pathname) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
   return -1;
 }
 
 int VFS::unlink(const String &pathname) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
   return -1;
 }
 
 int VFS::mount(const String &device_name, const String &mountpoint, const String &fs_name) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-
   // Check if `mountpoint` exists.
   SharedPtr<Vnode> vnode = resolve_path(mountpoint);
 
@@ -346,22 +363,18 @@ int VFS::mount(const String &device_name, const String &mountpoint, const String
   if (fs_name == "tmpfs") {
     printk("VFS: mounting TmpFS on %s\n", mountpoint.c_str());
     auto tmpfs = make_shared<TmpFS>();
-    auto mount = make_unique<Mount>(tmpfs, tmpfs->get_root_vnode(), vnode);
-    _mounts.push_back(move(mount));
+    add_mount(make_shared<Mount>(tmpfs, tmpfs->get_root_vnode(), vnode));
 
   } else if (fs_name == "procfs") {
     printk("VFS: mounting ProcFS on %s\n", mountpoint.c_str());
     auto procfs = make_shared<ProcFS>();
-    auto mount = make_unique<Mount>(procfs, procfs->get_root_vnode(), vnode);
-    _mounts.push_back(move(mount));
+    add_mount(make_shared<Mount>(procfs, procfs->get_root_vnode(), vnode));
   }
 
   return 0;
 }
 
 int VFS::umount(const String &mountpoint) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-
   // Check if `mountpoint` is valid.
   SharedPtr<Vnode> vnode = resolve_path(mountpoint);
 
@@ -370,24 +383,21 @@ int VFS::umount(const String &mountpoint) {
     return -1;
   }
 
-  auto it =
-      _mounts.find_if([&vnode](const auto &mount) { return mount->guest_vnode == vnode; });
-
-  if (it == _mounts.end()) [[unlikely]] {
+  if (!remove_mount(vnode)) [[unlikely]] {
     printk("VFS::umount: %s has not been mounted yet\n", mountpoint.c_str());
     return -1;
   }
 
+  // Let go of the vnodes of the unmounted filesystem.
+  _dcache.invalidate_all();
+
   printk("VFS: umounting %s\n", mountpoint.c_str());
-  _mounts.remove_if([&vnode](const auto &mount) { return mount->guest_vnode == vnode; });
 
   // FIXME: free the corresponding fs
   return 0;
 }
 
 int VFS::mknod(const String &pathname, mode_t mode, dev_t dev) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-
   // This special filesystem node must be either:
   // 1. a character device
   // 2. a block device
@@ -408,106 +418,178 @@ int VFS::mknod(const String &pathname, mode_t mode, dev_t dev) {
   return 0;
 }
 
-SharedPtr<Vnode> VFS::get_mounted_vnode_or_host_vnode(SharedPtr<Vnode> vnode) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+void VFS::add_mount(SharedPtr<Mount> mount) {
+  const LockGuard<Mutex> lock(_mounts_update_lock);
+  Vnode &host_vnode = *mount->host_vnode;
 
-  if (!vnode) {
-    return nullptr;
-  }
+  rcu_update(_mounts, [&mount](auto &mounts) { mounts.push_back(mount); });
+  // The newest mount on a host vnode comes first, so that it's the one found
+  // by get_mounted_vnode_or_host_vnode() while it hides the older ones.
+  rcu_update(_mount_hash[mount_hash_of(host_vnode)],
+             [&mount](auto &mounts) { mounts.push_front(mount); });
+
+  // Only raise the flag once the mount can be found in `_mount_hash`.
+  host_vnode.set_mountpoint(true);
+  _dcache.invalidate_all();
+}
 
-  auto it = _mounts.find_if([&vnode](const auto &mount) {
-    return mount->host_vnode->hash_code() == vnode->hash_code();
+bool VFS::remove_mount(SharedPtr<Vnode> guest_vnode) {
+  const LockGuard<Mutex> lock(_mounts_update_lock);
+  SharedPtr<Mount> mount;
+
+  rcu_update(_mounts, [&guest_vnode, &mount](auto &mounts) {
+    auto it =
+        mounts.find_if([&guest_vnode](const auto &m) { return m->guest_vnode == guest_vnode; });
+
+    if (it != mounts.end()) {
+      mount = *it;
+      mounts.erase(it.index());
+    }
   });
 
-  return (it != _mounts.end()) ? (*it)->guest_vnode : vnode;
+  if (!mount) [[unlikely]] {
+    return false;
+  }
+
+  Vnode &host_vnode = *mount->host_vnode;
+  bool is_still_mountpoint = false;
+
+  rcu_update(_mount_hash[mount_hash_of(host_vnode)],
+             [&mount, &host_vnode, &is_still_mountpoint](auto &mounts) {
+               mounts.remove_if([&mount](const auto &m) { return m == mount; });
+
+               // Other mounts may still be stacked on the same host vnode.
+               is_still_mountpoint = mounts.find_if([&host_vnode](const auto &m) {
+                 return m->host_vnode.get() == &host_vnode;
+               }) != mounts.end();
+             });
+
+  if (!is_still_mountpoint) {
+    host_vnode.set_mountpoint(false);
+  }
+
+  return true;
 }
 
-SharedPtr<Vnode> VFS::resolve_path(const String &pathname, SharedPtr<Vnode> *out_parent,
-                                   String *out_basename) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+size_t VFS::mount_hash_of(const Vnode &host_vnode) {
+  // The low bits of `&host_vnode` are always zero, since a Vnode is 8-byte aligned.
+  return (reinterpret_cast<size_t>(&host_vnode) >> 3) % NR_MOUNT_HASH_BUCKETS;
+}
 
-  if (pathname == ".") {
-    // FIXME: what about out_parent and out_basename?
-    return Task::current()->get_cwd_vnode();
+SharedPtr<Vnode> VFS::get_mounted_vnode_or_host_vnode(SharedPtr<Vnode> vnode) {
+  // The common case: `vnode` is not a mountpoint.
+  if (!vnode || !vnode->is_mountpoint()) [[likely]] {
+    return vnode;
   }
 
-  List<String> components = pathname.split('/');
+  const RCUReadGuard guard;
 
-  if (components.empty()) {
-    if (out_parent) {
-      *out_parent = nullptr;
-    }
+  // The root of a mounted filesystem may itself have been mounted on.
+  while (vnode->is_mountpoint()) {
+    MountTable *mounts = _mount_hash[mount_hash_of(*vnode)].read();
+
+    auto it = mounts->find_if(
+        [&vnode](const auto &mount) { return mount->host_vnode.get() == vnode.get(); });
 
-    if (out_basename) {
-      *out_basename = "";
+    // It's being unmounted.
+    if (it == mounts->end()) [[unlikely]] {
+      break;
     }
 
-    return get_rootfs().get_root_vnode();
+    vnode = (*it)->guest_vnode;
   }
 
-  const bool absolute = pathname.front() == '/';
-  auto root_vnode =
-      (absolute) ? get_rootfs().get_root_vnode() : Task::current()->get_cwd_vnode();
+  return vnode;
+}
 
-  // If `pathname` is something like "/bin",
-  // then we can simply check if "bin" exists under the root vnode.
-  // Also, `out_parent` is simply the root_vnode.
-  if (components.size() == 1) {
-    if (out_parent) {
-      *out_parent = root_vnode;
-    }
+SharedPtr<Vnode> VFS::lookup_child(SharedPtr<Vnode> dir, StringView name, size_t name_hash) {
+  SharedPtr<Vnode> child;
+  const bool cacheable = dir->is_lookup_cacheable();
+
+  if (cacheable && _dcache.lookup(*dir, name, name_hash, child)) [[likely]] {
+    return get_mounted_vnode_or_host_vnode(move(child));
+  }
 
-    if (out_basename) {
-      *out_basename = components.front();
+  {
+    const LockGuard<Mutex> lock(dir->get_lock());
+    child = dir->get_child(name.to_string());
+
+    if (cacheable) {
+      _dcache.insert(dir, name, name_hash, child);
     }
+  }
+
+  return get_mounted_vnode_or_host_vnode(move(child));
+}
+
+SharedPtr<Vnode> VFS::resolve_path(StringView pathname, SharedPtr<Vnode> *out_parent,
+                                   StringView *out_basename) {
+  PathWalker walker(pathname);
+
+  // An empty pathname is treated as "/".
+  const bool absolute = pathname.empty() || walker.is_absolute();
+  SharedPtr<Vnode> vnode =
+      (absolute) ? get_rootfs().get_root_vnode() : Task::current()->get_cwd_vnode();
+
+  // If `pathname` has no components at all (e.g., "/" or "."),
+  // then it refers to where we start from, which has no parent here.
+  if (out_parent) {
+    *out_parent = nullptr;
+  }
 
-    return get_mounted_vnode_or_host_vnode(root_vnode->get_child(components.front()));
+  if (out_basename) {
+    *out_basename = {};
   }
 
-  // Otherwise, we need to search the tree.
-  auto vnode = root_vnode;
+  while (walker.next()) {
+    if (walker.is_last()) {
+      if (out_parent) {
+        *out_parent = vnode;
+      }
 
-  for (auto it = components.begin(); it != components.end(); it++) {
-    if (out_parent && it.index() == components.size() - 1) {
-      *out_parent = vnode;
+      if (out_basename) {
+        *out_basename = walker.get_component();
+      }
     }
 
-    auto child = get_mounted_vnode_or_host_vnode(vnode->get_child(*it));
+    vnode = lookup_child(vnode, walker.get_component(), walker.get_component_hash());
 
-    if (!child) {
-      vnode = nullptr;
+    if (!vnode) {
       break;
     }
-    vnode = child;
-  }
-
-  if (out_basename) {
-    *out_basename = components.back();
   }
 
   return vnode;
 }
 
 dev_t VFS::register_device(Device &device) {
+  const LockGuard<Mutex> lock(_devices_update_lock);
+
   dev_t dev = Device::encode(_next_dev_major++, 0);
-  _registered_devices.push_back(Pair<dev_t, Device *>{dev, &device});
+  rcu_update(_registered_devices, [dev, &device](auto &devices) {
+    devices.push_back(Pair<dev_t, Device *>{dev, &device});
+  });
   return dev;
 }
 
 Device *VFS::find_registered_device(dev_t dev) {
-  auto it = _registered_devices.find_if(
+  const RCUReadGuard guard;
+  DeviceTable *devices = _registered_devices.read();
+
+  auto it = devices->find_if(
       [dev](const auto &entry) { return Device::major(dev) == Device::major(entry.first); });
 
-  return (it != _registered_devices.end()) ? it->second : nullptr;
+  return (it != devices->end()) ? it->second : nullptr;
 }
 
 SharedPtr<Vnode> VFS::get_host_vnode(SharedPtr<Vnode> guest_vnode) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  const RCUReadGuard guard;
+  MountTable *mounts = _mounts.read();
 
-  auto it = _mounts.find_if(
+  auto it = mounts->find_if(
       [&guest_vnode](const auto &mount) { return mount->guest_vnode == guest_vnode; });
 
-  return (it != _mounts.end()) ? it->get()->host_vnode : nullptr;
+  return (it != mounts->end()) ? it->get()->host_vnode : nullptr;
 }
 
 VFS::Mount::Mount(SharedPtr<FileSystem> guest_fs, SharedPtr<Vnode> guest_vnode,
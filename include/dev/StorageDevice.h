@@ -8,6 +8,7 @@
 
 #include <dev/BlockDevice.h>
 #include <dev/DiskPartition.h>
+#include <proc/Mutex.h>
 
 namespace valkyrie::kernel {
 
@@ -27,6 +28,11 @@ class StorageDevice : public BlockDevice {
 
  protected:
   List<UniquePtr<DiskPartition>> _partitions;
+
+  // The driver polls the controller until a transfer completes, and
+  // only one transfer may be in flight. It's a sleepable Mutex, so IRQs
+  // remain enabled and other tasks keep running while we're waiting.
+  Mutex _io_lock;
 };
 
 }  // namespace valkyrie::kernel
@@ -7,6 +7,9 @@
 
 #include <dev/CharacterDevice.h>
 #include <driver/GPIO.h>
+#include <proc/WaitQueue.h>
+
+#define MINI_UART_RX_BUFFER_SIZE 256
 
 namespace valkyrie::kernel {
 
@@ -38,6 +41,9 @@ class MiniUART : public Singleton<MiniUART>, public CharacterDevice::Driver {
     puts_sync(s, newline);
   }
 
+  // Called by the IRQ handler when the receive FIFO holds some bytes.
+  void handle_irq();
+
  protected:
   MiniUART();
 
@@ -50,6 +56,12 @@ class MiniUART : public Singleton<MiniUART>, public CharacterDevice::Driver {
   void gets_sync(char *s);
   void putchar_sync(const char c);
   void puts_sync(const char *s, bool newline = true);
+
+  // Bytes received by handle_irq() but not yet consumed by recv().
+  uint8_t _rx_buffer[MINI_UART_RX_BUFFER_SIZE];
+  size_t _rx_head;
+  size_t _rx_tail;
+  WaitQueue _rx_wait_queue;
 };
 
 }  // namespace valkyrie::kernel
@@ -0,0 +1,67 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// AddressSpace.h - The page cache of a vnode.
+//
+// An AddressSpace holds the pages of a vnode's content that have been read
+// so far, in a RadixTree indexed by (file offset / PAGE_SIZE). A missing page
+// is read in with Vnode::read_page(). VFS::read() copies from these pages,
+// and a file-backed mmap() maps them into the user's address space as they
+// are, so read() and mmap() users of a file share the same page frames.
+//
+// The cache holds a reference to each of its page frames (see
+// MemoryManager::inc_page_ref_count()), as does each mapping of it, so a
+// page frame that is still mapped somewhere outlives its removal from the
+// cache, and a write to a writable mapping of it triggers CoW.
+//
+// The caller must hold the lock of the vnode.
+#ifndef VALKYRIE_ADDRESS_SPACE_H_
+#define VALKYRIE_ADDRESS_SPACE_H_
+
+#include <RadixTree.h>
+#include <TypeTraits.h>
+#include <Types.h>
+
+namespace valkyrie::kernel {
+
+// Forward declaration
+class Vnode;
+
+class AddressSpace {
+  MAKE_NONCOPYABLE(AddressSpace);
+  MAKE_NONMOVABLE(AddressSpace);
+
+ public:
+  explicit AddressSpace(Vnode &host);
+  ~AddressSpace();
+
+  // Returns the (physical) page frame that holds the `index`-th page of the
+  // content, reading it in on a miss, or nullptr if that has failed.
+  [[nodiscard]] void *get_page(size_t index);
+
+  // Returns true if the `index`-th page is in the cache. Never reads it in.
+  bool contains(size_t index) const {
+    return _pages.get(index);
+  }
+
+  // Copies at most `len` bytes of the content, starting at `offset`, into `buf`,
+  // and returns the number of bytes copied.
+  size_t read_at(off_t offset, void *buf, size_t len);
+
+  // Drops all the cached pages, e.g., once the content has been replaced.
+  void invalidate();
+
+  size_t get_nr_pages() const {
+    return _nr_pages;
+  }
+
+ private:
+  static void put_page(void *page);
+
+  Vnode &_host;
+  RadixTree<void> _pages;
+  size_t _nr_pages;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_ADDRESS_SPACE_H_
@@ -0,0 +1,102 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// DentryCache.h - A cache of the results of Vnode::get_child().
+//
+// Looking up a name in a directory may be expensive (e.g., on FAT32 it
+// reads and parses the directory's clusters), so VFS::resolve_path() looks
+// in here first. Each dentry maps (directory, name) to the child vnode, or
+// to nullptr if the directory has no such child (a negative dentry), so that
+// probing for a missing file doesn't go to the filesystem either.
+//
+// A dentry holds a reference to both its directory and its child, and the
+// child it returns is the same vnode object on every hit, so a path that is
+// walked again and again yields the same vnodes each time.
+//
+// The cache holds at most DCACHE_CAPACITY dentries, and evicts the least
+// recently used one to make room for a new one.
+//
+// The VFS must hold the directory's lock while it looks up a name in the
+// directory and inserts the result, and while it modifies the directory, so
+// a dentry can't be made stale by a concurrent create(). lookup() itself
+// needs no lock but the cache's own.
+#ifndef VALKYRIE_DENTRY_CACHE_H_
+#define VALKYRIE_DENTRY_CACHE_H_
+
+#include <IntrusiveList.h>
+#include <Memory.h>
+#include <SpinLock.h>
+#include <String.h>
+#include <StringView.h>
+#include <TypeTraits.h>
+#include <Types.h>
+
+#include <fs/Vnode.h>
+
+#define DCACHE_CAPACITY 256
+#define DCACHE_HASH_SIZE 64
+
+namespace valkyrie::kernel {
+
+class DentryCache {
+  MAKE_NONCOPYABLE(DentryCache);
+  MAKE_NONMOVABLE(DentryCache);
+
+ public:
+  DentryCache();
+  ~DentryCache();
+
+  // `name_hash` is Hash<StringView>{}(name), which the caller may have
+  // computed along the way (see PathWalker).
+  //
+  // Returns false on a miss. On a hit, `out` is set to the cached child,
+  // which is nullptr for a negative dentry. Never allocates.
+  [[nodiscard]] bool lookup(const Vnode &dir, StringView name, size_t name_hash,
+                            SharedPtr<Vnode> &out);
+
+  // Caches the result of looking up `name` in `dir`, replacing the old one if any.
+  void insert(SharedPtr<Vnode> dir, StringView name, size_t name_hash,
+              SharedPtr<Vnode> child);
+
+  // Drops the dentry of `name` in `dir`, if any.
+  void invalidate(const Vnode &dir, StringView name);
+
+  // Drops all the dentries, e.g., when the mount table changes.
+  void invalidate_all();
+
+ private:
+  struct Dentry final {
+    Dentry(SharedPtr<Vnode> dir, StringView name, size_t name_hash, SharedPtr<Vnode> vnode)
+        : hash_node(),
+          lru_node(),
+          dir(move(dir)),
+          name(name.to_string()),
+          name_size(name.size()),
+          name_hash(name_hash),
+          vnode(move(vnode)) {}
+
+    IntrusiveListNode hash_node;
+    IntrusiveListNode lru_node;
+    SharedPtr<Vnode> dir;
+    String name;
+    size_t name_size;
+    size_t name_hash;
+    SharedPtr<Vnode> vnode;  // nullptr if negative
+  };
+
+  using HashList = IntrusiveList<Dentry, &Dentry::hash_node>;
+  using LRUList = IntrusiveList<Dentry, &Dentry::lru_node>;
+
+  static size_t bucket_of(const Vnode &dir, size_t name_hash);
+
+  Dentry *find(const Vnode &dir, StringView name, size_t name_hash);
+  void unlink(Dentry &dentry);
+
+  SpinLock _lock;
+  HashList _buckets[DCACHE_HASH_SIZE];
+  LRUList _lru;  // the least recently used one is at the front
+  size_t _size;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_DENTRY_CACHE_H_
@@ -17,6 +17,7 @@
 #include <Utility.h>
 
 #include <fs/File.h>
+#include <fs/VirtualFileSystem.h>
 
 // PIE elf base
 #define ELF_DEFAULT_BASE 0x400000
@@ -78,11 +79,6 @@ class ELF {
     static constexpr uint32_t w = 1 << 1;
     static constexpr uint32_t r = 1 << 2;
 
-    // Returns the pointer to the raw data of this segment.
-    const char *get_content(const char *elf_base) {
-      return elf_base + file_offset;
-    }
-
     ELF::SegmentType type;      // type
     uint32_t flags;             // flags
     uint64_t file_offset;       // offset
@@ -107,20 +103,27 @@ class ELF {
     uint64_t entsize;    // Entry size if section holds table
   };
 
-  ELF(SharedPtr<File> file)
-      : _base(file ? file->vnode->get_content() : nullptr),
-        _len(file ? file->vnode->get_size() : 0),
-        _elf_header(file ? reinterpret_cast<const ELF::Header *>(_base) : nullptr),
-        _segments() {
-    if (!file) {
+  // The headers are read through the VFS, and thus the page cache,
+  // from which the segments are mapped later on (see Task::do_mmap()).
+  ELF(SharedPtr<File> file) : _file(move(file)), _elf_header(), _is_header_read(), _segments() {
+    if (!_file) {
+      return;
+    }
+
+    _is_header_read = read(0, &_elf_header, sizeof(_elf_header));
+
+    if (!is_valid()) {
       return;
     }
 
     // Populate _segments by parsing the program headers.
-    const char *ptr = _base + _elf_header->phoff;
-    for (int i = 0; i < _elf_header->phnum; i++) {
-      _segments.push_back(*reinterpret_cast<const Segment *>(ptr));
-      ptr += _elf_header->phentsize;
+    for (int i = 0; i < _elf_header.phnum; i++) {
+      Segment segment;
+
+      if (!read(_elf_header.phoff + i * _elf_header.phentsize, &segment, sizeof(segment))) {
+        break;
+      }
+      _segments.push_back(segment);
     }
   }
 
@@ -129,27 +132,28 @@ class ELF {
     return _segments;
   }
 
-  const char *get_base() const {
-    return _base;
-  }
-
   bool exists() const {
-    return _base;
+    return _file;
   }
 
   bool is_valid() const {
-    return !memcmp(_elf_header->ident, ELF::magic, ELF::magic_len);
+    return _is_header_read && !memcmp(_elf_header.ident, ELF::magic, ELF::magic_len);
   }
 
   void *get_entry_point() const {
-    return reinterpret_cast<void *>(ELF_DEFAULT_BASE + _elf_header->entry);
+    return reinterpret_cast<void *>(ELF_DEFAULT_BASE + _elf_header.entry);
   }
 
  private:
-  const char *_base;
-  const size_t _len;
+  // Reads exactly `len` bytes at `offset` of the file into `buf`.
+  bool read(size_t offset, void *buf, size_t len) {
+    _file->pos = offset;
+    return VFS::the().read(_file, buf, len) == static_cast<int>(len);
+  }
 
-  const ELF::Header *_elf_header;
+  SharedPtr<File> _file;
+  ELF::Header _elf_header;
+  bool _is_header_read;
   List<Segment> _segments;
 };
 
@@ -2,15 +2,20 @@
 #ifndef VALKYRIE_FAT32_H_
 #define VALKYRIE_FAT32_H_
 
+#include <Atomic.h>
 #include <Encoding.h>
 #include <Functional.h>
 #include <List.h>
 #include <Memory.h>
+#include <SpinLock.h>
 #include <Types.h>
 
 #include <dev/DiskPartition.h>
 #include <fs/FileSystem.h>
 #include <fs/Vnode.h>
+#include <proc/RWSemaphore.h>
+
+#define FAT32_INODE_CACHE_SIZE 64
 
 namespace valkyrie::kernel {
 
@@ -27,6 +32,12 @@ class FAT32 final : public FileSystem {
 
   virtual SharedPtr<Vnode> get_root_vnode() override;
 
+  // How many FAT32Inode::read_at() calls have gone to the disk, and how many
+  // of them did so with IRQs masked. Only the reads issued under
+  // Kernel::mutex (e.g., by exec()) should ever add to the latter.
+  static size_t get_nr_disk_reads();
+  static size_t get_nr_irqs_off_disk_reads();
+
  private:
   // In FAT32 with LFN (Long File Name) support, there
   // are two types of directory entries:
@@ -170,10 +181,31 @@ class FAT32 final : public FileSystem {
   bool is_valid_short_filename_char(const uint8_t c) const;
   bool can_fit_within_83_short_filename(const String &long_filename) const;
 
+  // Returns the live inode of the file referred to by `dentry_view`,
+  // or creates one (and caches it) if there's none.
+  SharedPtr<FAT32Inode> get_inode(const DirectoryEntryView &dentry_view);
+  void cache_inode(const SharedPtr<FAT32Inode> &inode);
+
   DiskPartition &_disk_partition;
   const BootSector _metadata;
   int _nr_fat_entries_per_sector;
   SharedPtr<FAT32Inode> _root_inode;
+
+  // Each file has at most one FAT32Inode at a time, which is looked up here
+  // by FAT32Inode::get_key(). The cache doesn't keep the inodes alive, and
+  // an entry whose inode is gone is dropped by the next lookup in its bucket.
+  SpinLock _inode_cache_lock;
+  List<WeakPtr<FAT32Inode>> _inode_cache[FAT32_INODE_CACHE_SIZE];
+
+  // The per-vnode lock taken by the VFS serializes the accesses to a file,
+  // but not to the FAT or to the directory clusters which files share.
+  // Directory lookups and file reads take it shared, while anything which
+  // modifies a directory, a file or the FAT takes it exclusively.
+  mutable RWSemaphore _rwsem;
+
+  // Shown in /proc/stat.
+  static inline Atomic<size_t> _nr_disk_reads;
+  static inline Atomic<size_t> _nr_irqs_off_disk_reads;
 };
 
 class FAT32Inode final : public Vnode {
@@ -213,14 +245,31 @@ class FAT32Inode final : public Vnode {
   virtual String get_name() const override;
   virtual char *get_content() override;
   virtual void set_content(UniquePtr<char[]> content, off_t new_size) override;
+  virtual size_t read_at(off_t offset, void *buf, size_t len) override;
   virtual size_t hash_code() const override;
   virtual bool is_root_vnode() const override;
 
+  // Identifies the file this inode refers to. A directory is identified by
+  // its first cluster, since its "." and ".." entries refer to it as well.
+  // A regular file may not have a cluster yet, so it's identified by the
+  // location of its directory entry instead.
+  static uint64_t get_key(mode_t mode, uint32_t first_cluster_number,
+                          uint32_t parent_cluster_number, uint32_t parent_cluster_offset);
+
+  uint64_t get_key() const {
+    return get_key(_mode, _first_cluster_number, _parent_cluster_number,
+                   _parent_cluster_offset);
+  }
+
  private:
   uint32_t dir_first_cluster_number() const;
 
   void allocate_first_cluster() const;
 
+  // Returns the cluster number of the `i`-th cluster of this file,
+  // or an EOC mark if the file doesn't have that many clusters.
+  uint32_t get_ith_cluster_number(uint32_t i);
+
   void update_dentry_to_disk(Function<void(FAT32::DirectoryEntry *)> callback) const;
 
   SharedPtr<FAT32Inode> find_child_if(
@@ -239,6 +288,12 @@ class FAT32Inode final : public Vnode {
   uint32_t _parent_cluster_number;
   uint32_t _parent_cluster_offset;
   UniquePtr<char[]> _content;
+
+  // The cluster read_at() has read last, so that a sequential read can pick
+  // up from there instead of walking the cluster chain from the start.
+  // Protected by the vnode lock, and reset when the chain is rewritten.
+  uint32_t _cursor_cluster_index;
+  uint32_t _cursor_cluster_number;
 };
 
 // Explicit (full) specialization of `struct Hash` for FAT32Inode.
@@ -248,10 +303,7 @@ struct Hash<FAT32Inode> final {
     constexpr size_t prime = 17;
     size_t ret = 7;
 
-    ret += prime * hash(inode._size);
-    ret += prime * hash(inode._mode);
-    // ret += hash(inode._name);
-    ret += prime * hash(inode._first_cluster_number);
+    ret += prime * hash(inode.get_key());
     return ret;
   }
 };
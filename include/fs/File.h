@@ -2,6 +2,12 @@
 //
 // File.h - Represents a file opened by the kernel.
 //
+// A File is an open file description: each open() creates a new one with
+// its own offset, while the fds that a forked child inherits refer to the
+// same description as its parent's do, and thus share its offset. It's
+// freed once the last fd referring to it is closed.
+//
+// `pos` and `ra` are only modified under the lock of `vnode`.
 // Reference:
 // [1] https://man7.org/training/download/lusp_fileio_slides.pdf
 
@@ -11,6 +17,7 @@
 #include <Memory.h>
 #include <Types.h>
 
+#include <fs/Readahead.h>
 #include <fs/Vnode.h>
 
 namespace valkyrie::kernel {
@@ -20,12 +27,13 @@ class FileSystem;
 
 struct File final {
   File(FileSystem &fs, SharedPtr<Vnode> vnode, int options)
-      : fs(fs), vnode(move(vnode)), pos(), options(options) {}
+      : fs(fs), vnode(move(vnode)), pos(), options(options), ra() {}
 
   FileSystem &fs;  // the filesystem to which this file belong.
   SharedPtr<Vnode> vnode;
   size_t pos;  // the next r/w position of this opened file.
   int options;
+  ReadaheadState ra;  // see Readahead.h
 };
 
 }  // namespace valkyrie::kernel
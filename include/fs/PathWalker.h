@@ -0,0 +1,90 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// PathWalker.h - Iterates over the components of a pathname.
+//
+// Each component is a StringView into the caller's pathname, and its hash
+// (for the DentryCache) is computed as it's being scanned, so walking a path
+// neither allocates nor goes over any character twice. Empty components
+// (from "//" or a trailing '/') are skipped, and so is ".", since it always
+// refers to the directory we're already in. ".." is a component like any
+// other, which the directory itself resolves.
+#ifndef VALKYRIE_PATH_WALKER_H_
+#define VALKYRIE_PATH_WALKER_H_
+
+#include <Hash.h>
+#include <StringView.h>
+#include <Types.h>
+
+namespace valkyrie::kernel {
+
+class PathWalker {
+ public:
+  explicit PathWalker(StringView pathname) : _pathname(pathname), _pos(), _component(), _hash() {
+    skip_dots_and_slashes();
+  }
+
+  ~PathWalker() = default;
+
+  bool is_absolute() const {
+    return !_pathname.empty() && _pathname.front() == '/';
+  }
+
+  // Moves on to the next component. Returns false if there's none left.
+  bool next() {
+    if (_pos >= _pathname.size()) {
+      return false;
+    }
+
+    constexpr size_t prime = 19;  // see Hash<StringView>
+    const size_t begin = _pos;
+    _hash = 5;
+
+    for (; _pos < _pathname.size() && _pathname[_pos] != '/'; _pos++) {
+      _hash += prime * hash(_pathname[_pos]);
+    }
+
+    _component = _pathname.substr(begin, _pos - begin);
+    skip_dots_and_slashes();
+    return true;
+  }
+
+  // Whether the current component is the last one.
+  bool is_last() const {
+    return _pos >= _pathname.size();
+  }
+
+  StringView get_component() const {
+    return _component;
+  }
+
+  size_t get_component_hash() const {
+    return _hash;
+  }
+
+ private:
+  void skip_dots_and_slashes() {
+    while (_pos < _pathname.size()) {
+      if (_pathname[_pos] == '/') {
+        _pos++;
+      } else if (is_dot_at(_pos)) {
+        _pos++;
+      } else {
+        break;
+      }
+    }
+  }
+
+  // Whether the component starting at `pos` is ".".
+  bool is_dot_at(size_t pos) const {
+    return _pathname[pos] == '.' && (pos + 1 == _pathname.size() || _pathname[pos + 1] == '/');
+  }
+
+  StringView _pathname;
+  size_t _pos;
+  StringView _component;
+  size_t _hash;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_PATH_WALKER_H_
@@ -62,6 +62,16 @@ class ProcFSInode : public Vnode, public EnableSharedFromThis<ProcFSInode> {
   virtual size_t hash_code() const override;
   virtual bool is_root_vnode() const override;
 
+  // The task directories come and go with the tasks.
+  virtual bool is_lookup_cacheable() const override {
+    return false;
+  }
+
+  // The content is generated on each read.
+  virtual bool is_page_cacheable() const override {
+    return false;
+  }
+
  protected:
   ProcFS &_fs;
   String _name;
@@ -119,6 +129,39 @@ class SlobInfoInode : public ProcFSInode {
   virtual char *get_content() override;
 };
 
+class StatInode : public ProcFSInode {
+ public:
+  StatInode(ProcFS &fs)
+      : ProcFSInode(fs, static_pointer_cast<ProcFSInode>(fs.get_root_vnode()), "stat",
+                    S_IFREG) {}
+
+  virtual ~StatInode() = default;
+
+  virtual char *get_content() override;
+};
+
+class SchedStatInode : public ProcFSInode {
+ public:
+  SchedStatInode(ProcFS &fs)
+      : ProcFSInode(fs, static_pointer_cast<ProcFSInode>(fs.get_root_vnode()), "schedstat",
+                    S_IFREG) {}
+
+  virtual ~SchedStatInode() = default;
+
+  virtual char *get_content() override;
+};
+
+class ReadaheadInode : public ProcFSInode {
+ public:
+  ReadaheadInode(ProcFS &fs)
+      : ProcFSInode(fs, static_pointer_cast<ProcFSInode>(fs.get_root_vnode()), "readahead",
+                    S_IFREG) {}
+
+  virtual ~ReadaheadInode() = default;
+
+  virtual char *get_content() override;
+};
+
 class TaskStatusInode : public ProcFSInode {
  public:
   TaskStatusInode(ProcFS &fs, SharedPtr<ProcFSInode> parent)
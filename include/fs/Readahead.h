@@ -0,0 +1,94 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// Readahead.h - Prefetches the pages a sequential reader is about to read.
+//
+// Each open file description keeps a ReadaheadState. When a read() picks up
+// where the previous one left off, the pages right after it are queued to
+// kreadaheadd, which reads them into the page cache in the background while
+// the reader is busy with what it has got. The window starts at
+// RA_MIN_PAGES and doubles each time the reader catches up with it, up to
+// RA_MAX_PAGES. A read() anywhere else halves the window instead, and no
+// pages are prefetched until the reader goes sequential again.
+//
+// The next window is queued as soon as the reader enters the current one,
+// so there is always about one window in flight ahead of the reader.
+//
+// The hit and miss counters tell how many of the pages that read() asked
+// for were already in the page cache, and are shown in /proc/readahead.
+#ifndef VALKYRIE_READAHEAD_H_
+#define VALKYRIE_READAHEAD_H_
+
+#include <Atomic.h>
+#include <List.h>
+#include <Memory.h>
+#include <Singleton.h>
+#include <Types.h>
+
+#include <proc/WaitQueue.h>
+
+#define RA_MIN_PAGES 4          /* 16 KiB */
+#define RA_MAX_PAGES 64         /* 256 KiB */
+#define NR_READAHEAD_REQUESTS 16
+
+namespace valkyrie::kernel {
+
+// Forward declaration
+struct File;
+class Vnode;
+[[noreturn]] void start_kreadaheadd();
+
+// Only accessed under the lock of the file's vnode, as is File::pos.
+struct ReadaheadState final {
+  static constexpr const size_t npos = static_cast<size_t>(-1);
+
+  ReadaheadState() : prev_index(npos), start(), size(RA_MIN_PAGES), mark(npos) {}
+
+  size_t prev_index;  // the last page of the previous read
+  size_t start;       // the first page of the window queued most recently
+  size_t size;        // the number of pages in that window
+  size_t mark;        // the next window is queued once a read reaches this page
+};
+
+class Readahead : public Singleton<Readahead> {
+  friend void start_kreadaheadd();
+
+ public:
+  // Called by VFS::read() before it reads `len` bytes at `file.pos` from
+  // the page cache. The caller must hold the lock of the file's vnode.
+  void on_read(File &file, size_t len);
+
+  size_t get_nr_hits() const;
+  size_t get_nr_misses() const;
+  size_t get_nr_pages_read_ahead() const;
+  size_t get_nr_requests_dropped() const;
+
+ protected:
+  Readahead();
+
+ private:
+  struct Request final {
+    SharedPtr<Vnode> vnode;
+    size_t start;
+    size_t nr_pages;
+  };
+
+  // Queues `nr_pages` pages of `vnode` from `start` to kreadaheadd.
+  // The request is dropped if too many of them are pending already.
+  void submit(SharedPtr<Vnode> vnode, size_t start, size_t nr_pages);
+
+  // Reads in the requested pages that aren't in the page cache yet.
+  void process(const Request &request);
+
+  // `_requests` and `_wait_queue` are protected by Kernel::mutex.
+  List<Request> _requests;
+  WaitQueue _wait_queue;
+
+  Atomic<size_t> _nr_hits;
+  Atomic<size_t> _nr_misses;
+  Atomic<size_t> _nr_pages_read_ahead;
+  Atomic<size_t> _nr_requests_dropped;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_READAHEAD_H_
@@ -59,6 +59,11 @@ class TmpFSInode final : public Vnode, public EnableSharedFromThis<TmpFSInode> {
   virtual size_t hash_code() const override;
   virtual bool is_root_vnode() const override;
 
+  // The content is in memory already.
+  virtual bool is_page_cacheable() const override {
+    return false;
+  }
+
  private:
   TmpFS &_fs;
   String _name;
@@ -6,15 +6,21 @@
 #include <Memory.h>
 #include <Mutex.h>
 #include <Singleton.h>
+#include <SpinLock.h>
+#include <StringView.h>
 #include <Utility.h>
 
 #include <dev/Device.h>
 #include <dev/StorageDevice.h>
 #include <fs/CPIOArchive.h>
+#include <fs/DentryCache.h>
 #include <fs/File.h>
 #include <fs/FileSystem.h>
+#include <proc/Mutex.h>
+#include <proc/RCU.h>
 
 #define NR_SPECIAL_ENTRIES 2 /* "." and ".." */
+#define NR_MOUNT_HASH_BUCKETS 16
 
 namespace valkyrie::kernel {
 
@@ -29,16 +35,19 @@ class VFS : public Singleton<VFS> {
     SharedPtr<Vnode> host_vnode;
   };
 
+  using MountTable = List<SharedPtr<Mount>>;
+  using DeviceTable = List<Pair<dev_t, Device *>>;
+
   void mount_rootfs();
   void mount_devtmpfs();
   void mount_procfs();
   void populate_devtmpfs();
 
-  SharedPtr<File> open(const String &pathname, int options);
+  SharedPtr<File> open(StringView pathname, int options);
   int close(SharedPtr<File> file);
   int write(SharedPtr<File> file, const void *buf, size_t len);
   int read(SharedPtr<File> file, void *buf, size_t len);
-  int access(const String &pathname, int options);
+  int access(StringView pathname, int options);
   int mkdir(const String &pathname);
   int rmdir(const String &pathname);
   int unlink(const String &pathname);
@@ -46,10 +55,11 @@ class VFS : public Singleton<VFS> {
   int umount(const String &mountpoint);
   int mknod(const String &pathname, mode_t mode, dev_t dev);
 
-  // Retrieves the target vnode by `pathname`.
-  [[nodiscard]] SharedPtr<Vnode> resolve_path(const String &pathname,
+  // Retrieves the target vnode by `pathname`. `out_basename`, if requested,
+  // refers to the last component within `pathname` itself.
+  [[nodiscard]] SharedPtr<Vnode> resolve_path(StringView pathname,
                                               SharedPtr<Vnode> *out_parent = nullptr,
-                                              String *out_basename = nullptr);
+                                              StringView *out_basename = nullptr);
 
   // The API for each device to register itself to the VFS.
   [[nodiscard]] dev_t register_device(Device &device);
@@ -58,12 +68,10 @@ class VFS : public Singleton<VFS> {
     return _next_inode_idx++;
   }
 
+  // The rootfs is never unmounted, so it outlives every version of the mount table.
   [[nodiscard]] FileSystem &get_rootfs() {
-    return *(_mounts.front()->guest_fs);
-  }
-
-  [[nodiscard]] List<SharedPtr<File>> &get_opened_files() {
-    return _opened_files;
+    const RCUReadGuard guard;
+    return *(_mounts.read()->front()->guest_fs);
   }
 
   [[nodiscard]] SharedPtr<Vnode> get_host_vnode(SharedPtr<Vnode> vnode);
@@ -75,20 +83,46 @@ class VFS : public Singleton<VFS> {
   void mount_rootfs(SharedPtr<FileSystem> fs);
   void mount_rootfs(SharedPtr<FileSystem> fs, const CPIOArchive &archive);
 
-  SharedPtr<Vnode> create(const String &pathname, const char *content, size_t size,
+  SharedPtr<Vnode> create(StringView pathname, const char *content, size_t size,
                           mode_t mode, uid_t uid, gid_t gid);
 
   [[nodiscard]] Device *find_registered_device(dev_t dev);
 
+  // Publishes `mount`, and marks its host vnode as a mountpoint.
+  void add_mount(SharedPtr<Mount> mount);
+
+  // Withdraws the mount whose guest vnode is `guest_vnode`.
+  // Returns false if there's no such mount.
+  bool remove_mount(SharedPtr<Vnode> guest_vnode);
+
+  static size_t mount_hash_of(const Vnode &host_vnode);
+
+  // Returns the root of the filesystem mounted on `vnode` if it's a mountpoint,
+  // or `vnode` itself otherwise, which only costs a flag test.
   [[nodiscard]] SharedPtr<Vnode> get_mounted_vnode_or_host_vnode(SharedPtr<Vnode> vnode);
 
+  // Looks up `name` in `dir` (in the dentry cache first, then under the lock
+  // of `dir`), and follows the mount on it. `name_hash` is Hash<StringView>{}(name).
+  [[nodiscard]] SharedPtr<Vnode> lookup_child(SharedPtr<Vnode> dir, StringView name,
+                                              size_t name_hash);
+
   uint64_t _next_inode_idx;
   uint64_t _next_dev_major;
 
-  List<UniquePtr<Mount>> _mounts;
-  List<SharedPtr<File>> _opened_files;  // FIXME: replace it with a HashMap (?)
+  // The mount table and the device registry are looked up all the time but
+  // hardly ever change, so readers traverse them under RCU, while writers
+  // publish a modified copy (see rcu_update() in fs/VirtualFileSystem.cc).
+  // Writers are serialized by the corresponding Mutex.
+  Mutex _mounts_update_lock;
+  RCUPointer<MountTable> _mounts;
   List<UniquePtr<StorageDevice>> _storage_devices;
-  List<Pair<dev_t, Device *>> _registered_devices;
+  Mutex _devices_update_lock;
+  RCUPointer<DeviceTable> _registered_devices;
+  DentryCache _dcache;
+
+  // The mounts again, but hashed by their host vnodes, which have
+  // Vnode::is_mountpoint() set. Also protected by `_mounts_update_lock`.
+  RCUPointer<MountTable> _mount_hash[NR_MOUNT_HASH_BUCKETS];
 };
 
 }  // namespace valkyrie::kernel
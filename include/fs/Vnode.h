@@ -2,20 +2,33 @@
 #ifndef VALKYRIE_VNODE_H_
 #define VALKYRIE_VNODE_H_
 
+#include <Algorithm.h>
+#include <CString.h>
 #include <Hash.h>
 #include <Memory.h>
 #include <String.h>
 #include <Types.h>
 
 #include <dev/Device.h>
+#include <fs/AddressSpace.h>
 #include <fs/Stat.h>
+#include <mm/mmu.h>
+#include <proc/Mutex.h>
 
 namespace valkyrie::kernel {
 
 class Vnode {
  public:
   Vnode(const uint32_t index, off_t size, mode_t mode, uid_t uid, gid_t gid)
-      : _index(index), _size(size), _mode(mode), _uid(uid), _gid(gid), _dev() {}
+      : _lock(),
+        _index(index),
+        _size(size),
+        _mode(mode),
+        _uid(uid),
+        _gid(gid),
+        _dev(),
+        _is_mountpoint(),
+        _mapping(*this) {}
 
   virtual ~Vnode() = default;
 
@@ -35,9 +48,60 @@ class Vnode {
   virtual String get_name() const = 0;
   virtual char *get_content() = 0;
   virtual void set_content(UniquePtr<char[]> content, off_t new_size) = 0;
+
+  // Copies at most `len` bytes of the content, starting at `offset`, into `buf`,
+  // and returns the number of bytes copied. By default it goes through
+  // get_content(), so a filesystem which has to fetch the content from disk
+  // overrides it to fetch only the requested part.
+  virtual size_t read_at(off_t offset, void *buf, size_t len) {
+    const char *content = get_content();
+
+    if (!content || offset >= _size) {
+      return 0;
+    }
+
+    len = min(len, static_cast<size_t>(_size - offset));
+    memcpy(buf, content + offset, len);
+    return len;
+  }
+
+  // Fills `page` with the `index`-th page of the content, zeroing whatever
+  // lies beyond the end of the file. The page cache calls it on a miss.
+  virtual bool read_page(size_t index, void *page) {
+    const size_t len = read_at(index * PAGE_SIZE, page, PAGE_SIZE);
+
+    memset(reinterpret_cast<char *>(page) + len, 0, PAGE_SIZE - len);
+    return true;
+  }
+
+  // Whether the VFS may keep the content in the page cache (see AddressSpace).
+  // A filesystem whose content is in memory anyway, or is generated on each
+  // read, returns false.
+  virtual bool is_page_cacheable() const {
+    return is_regular_file();
+  }
+
+  // The page cache of this vnode. It's protected by the vnode's lock.
+  AddressSpace &get_mapping() {
+    return _mapping;
+  }
+
   virtual size_t hash_code() const = 0;
   virtual bool is_root_vnode() const = 0;
 
+  // Whether the VFS may cache the results of get_child() (see DentryCache).
+  // A filesystem whose directories change on their own returns false.
+  virtual bool is_lookup_cacheable() const {
+    return true;
+  }
+
+  // Serializes the operations on this vnode's content and children.
+  // The VFS takes it, so filesystems shouldn't. It's a sleepable Mutex,
+  // so the filesystem may block on disk I/O while it's held.
+  Mutex &get_lock() const {
+    return _lock;
+  }
+
   bool is_directory() const {
     return Vnode::is_directory(_mode);
   }
@@ -66,6 +130,16 @@ class Vnode {
     return Vnode::is_socket(_mode);
   }
 
+  // Whether a filesystem is mounted on this vnode. Only the VFS sets it,
+  // under its mount table lock.
+  bool is_mountpoint() const {
+    return _is_mountpoint;
+  }
+
+  void set_mountpoint(bool is_mountpoint) {
+    _is_mountpoint = is_mountpoint;
+  }
+
   bool is_sticky() const {
     return _mode & S_ISVTX;
   }
@@ -163,6 +237,7 @@ class Vnode {
   }
 
  protected:
+  mutable Mutex _lock;
   const uint32_t _index;
   off_t _size;
   mode_t _mode;
@@ -172,6 +247,8 @@ class Vnode {
   time_t _atime;  // last access time
   time_t _mtime;  // last modification time
   dev_t _dev;     // 32 bits in total, 12 major, 20 minor.
+  bool _is_mountpoint;
+  AddressSpace _mapping;
 };
 
 }  // namespace valkyrie::kernel
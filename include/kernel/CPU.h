@@ -0,0 +1,22 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VALKYRIE_CPU_H_
+#define VALKYRIE_CPU_H_
+
+#include <Types.h>
+
+// The number of cores that run the kernel. The other cores of
+// the BCM2837 are parked in Kernel::halt() by boot/boot.S.
+#define NR_CPUS 1
+
+namespace valkyrie::kernel {
+
+// Returns the id of the calling core, i.e., MPIDR_EL1.Aff0.
+[[gnu::always_inline]] inline size_t get_cpu_id() {
+  uint64_t mpidr_el1;
+  asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr_el1));
+  return mpidr_el1 & 0xff;
+}
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_CPU_H_
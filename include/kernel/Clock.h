@@ -0,0 +1,73 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// Clock.h - The system clocksource.
+//
+// Time is derived from the 64-bit physical counter (CNTPCT_EL0), which ticks
+// at CNTFRQ_EL0 Hz from power-on and never wraps in practice. CLOCK_MONOTONIC
+// is the counter converted to nanoseconds, and CLOCK_REALTIME is CLOCK_MONOTONIC
+// plus an offset. The Raspberry Pi has no RTC, so the offset is 0 (the Epoch)
+// until someone sets it.
+//
+// The kernel also exports a read-only data page (the vdata page) to every
+// user task at USER_VDATA_PAGE, and allows EL0 to read CNTPCT_EL0 directly
+// (CNTKCTL_EL1.EL0PCTEN), so vlibc's clock_gettime() doesn't have to trap
+// into the kernel at all. The vdata page is protected by a sequence counter:
+// it's odd while the kernel is updating the page, so a reader retries
+// if it sees an odd value or if the value has changed after it's done.
+
+#ifndef VALKYRIE_CLOCK_H_
+#define VALKYRIE_CLOCK_H_
+
+#include <Singleton.h>
+#include <Types.h>
+
+#include <mm/VirtualMemoryMap.h>
+
+// The user virtual address of the vdata page. Must be kept in sync with vlibc.
+#define USER_VDATA_PAGE 0x00007fffffffd000
+
+// clock_gettime() clock ids
+#define CLOCK_REALTIME 0
+#define CLOCK_MONOTONIC 1
+
+#define NSEC_PER_SEC 1000000000
+
+namespace valkyrie::kernel {
+
+// See clock_gettime(2).
+struct TimeSpec final {
+  time_t tv_sec;
+  long tv_nsec;
+};
+
+// The layout of the vdata page. Must be kept in sync with vlibc.
+struct VDataPage final {
+  volatile uint32_t seq;
+  uint32_t reserved;
+  uint64_t cntfrq;              // CNTFRQ_EL0
+  uint64_t realtime_offset_ns;  // CLOCK_REALTIME - CLOCK_MONOTONIC
+};
+
+class Clock : public Singleton<Clock> {
+ public:
+  uint64_t get_monotonic_ns() const;
+  uint64_t get_realtime_ns() const;
+  void set_realtime_ns(const uint64_t ns);
+
+  // Returns 0 on success, or -1 if `clockid` is invalid.
+  int get_time(const int clockid, TimeSpec &ts) const;
+
+  // Maps the vdata page into a user address space (read-only).
+  void map_vdata_page(const VMMap &vmmap) const;
+
+ protected:
+  Clock();
+
+ private:
+  VDataPage *_vdata;    // kernel virtual address of the vdata page
+  void *_vdata_p_addr;  // physical address of the vdata page
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_CLOCK_H_
@@ -21,6 +21,12 @@
 
 #define IRQ_PENDING_1_HAS_PENDING_IRQ (1 << 8)
 
+// The ARM local interrupt source register of core 0, which tells us
+// whether an IRQ came from the core timer or from the GPU (peripherals).
+#define CORE0_IRQ_SOURCE (KERNEL_VA_BASE + 0x40000060)
+#define CORE0_IRQ_SOURCE_CNTPNSIRQ (1 << 1)
+#define CORE0_IRQ_SOURCE_GPU (1 << 8)
+
 #define SYSTEM_TIMER_IRQ_0 (1 << 0)
 #define SYSTEM_TIMER_IRQ_1 (1 << 1)
 #define SYSTEM_TIMER_IRQ_2 (1 << 2)
@@ -39,6 +45,25 @@ inline bool _is_activated = false;
   asm volatile("msr DAIFSET, #0b1111");
 }
 
+// Disables IRQs and returns the previous DAIF, which can be handed
+// to restore_irqs() later, so that it works even if IRQs were off.
+[[gnu::always_inline]] inline size_t save_and_disable_irqs() {
+  size_t daif;
+  asm volatile("mrs %0, DAIF" : "=r"(daif));
+  asm volatile("msr DAIFSET, #0b1111" ::: "memory");
+  return daif;
+}
+
+[[gnu::always_inline]] inline void restore_irqs(const size_t daif) {
+  asm volatile("msr DAIF, %0" ::"r"(daif) : "memory");
+}
+
+[[gnu::always_inline]] inline bool are_irqs_disabled() {
+  size_t daif;
+  asm volatile("mrs %0, DAIF" : "=r"(daif));
+  return daif & (1 << 7);  // the I bit
+}
+
 [[gnu::always_inline]] inline bool is_activated() {
   return _is_activated;
 }
@@ -9,7 +9,9 @@
 #include <dev/Console.h>
 #include <driver/Mailbox.h>
 #include <driver/MiniUART.h>
+#include <fs/Readahead.h>
 #include <fs/VirtualFileSystem.h>
+#include <kernel/Clock.h>
 #include <kernel/Exception.h>
 #include <kernel/TimerMultiplexer.h>
 #include <mm/MemoryManager.h>
@@ -46,6 +48,7 @@ class Kernel : public Singleton<Kernel> {
   Console &_console;
   TimerMultiplexer &_timer_multiplexer;
   MemoryManager &_memory_manager;
+  Clock &_clock;
   TaskScheduler &_task_scheduler;
   VFS &_vfs;
 };
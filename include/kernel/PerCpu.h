@@ -0,0 +1,97 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// PerCpu.h - Per-CPU data.
+//
+// TPIDR_EL1 of each core points to that core's CpuBlock, which holds the
+// current task, the core's id and its preemption state, so all of them are
+// a single system register read (plus a load) away.
+//
+// A per-CPU variable is defined with DEFINE_PER_CPU(type, name) and holds
+// NR_CPUS instances of `type`, one per core, each in its own cache line(s)
+// so that the cores never write to the same line. this_cpu(name) is the
+// calling core's instance, and per_cpu(name, cpu) is that of core `cpu`.
+//
+// Unlike a per-CPU linker section, every instance is constructed normally,
+// so a per-CPU variable may be of any type (e.g., a list head which points
+// to itself). It may also be a class member.
+//
+// The calling task must not migrate to another core while it holds a
+// reference to this_cpu(...), i.e., preemption must be disabled (see
+// include/proc/Preempt.h). This is trivially true as long as NR_CPUS is 1.
+#ifndef VALKYRIE_PER_CPU_H_
+#define VALKYRIE_PER_CPU_H_
+
+#include <TypeTraits.h>
+#include <Types.h>
+
+#include <kernel/CPU.h>
+
+#define CACHE_LINE_SIZE 64
+
+#define DEFINE_PER_CPU(type, name) ::valkyrie::kernel::PerCpu<type> name
+#define DECLARE_PER_CPU(type, name) extern ::valkyrie::kernel::PerCpu<type> name
+
+#define this_cpu(var) ((var).local())
+#define per_cpu(var, cpu) ((var).on(cpu))
+
+namespace valkyrie::kernel {
+
+// Forward declaration.
+class Task;
+
+struct alignas(CACHE_LINE_SIZE) CpuBlock final {
+  Task *current_task;  // must be the first member, see proc/ctx_switch.S
+  size_t cpu_id;
+  int preempt_count;  // of the current task, see include/proc/Preempt.h
+  bool need_resched;
+};
+
+inline CpuBlock cpu_blocks[NR_CPUS];
+
+// Points the calling core's TPIDR_EL1 to its CpuBlock. Each core must call
+// this before anything else calls Task::current() or this_cpu().
+inline void init_cpu_block() {
+  const size_t cpu_id = get_cpu_id();
+  CpuBlock *block = &cpu_blocks[cpu_id];
+
+  block->current_task = nullptr;
+  block->cpu_id = cpu_id;
+  block->preempt_count = 0;
+  block->need_resched = false;
+  asm volatile("msr tpidr_el1, %0" ::"r"(block));
+}
+
+[[gnu::always_inline]] inline CpuBlock &this_cpu_block() {
+  CpuBlock *ret;
+  asm volatile("mrs %0, tpidr_el1" : "=r"(ret));
+  return *ret;
+}
+
+template <typename T>
+class PerCpu {
+  MAKE_NONCOPYABLE(PerCpu);
+  MAKE_NONMOVABLE(PerCpu);
+
+ public:
+  PerCpu() : _slots() {}
+  ~PerCpu() = default;
+
+  T &local() {
+    return _slots[this_cpu_block().cpu_id].value;
+  }
+
+  T &on(const size_t cpu) {
+    return _slots[cpu].value;
+  }
+
+ private:
+  struct alignas(CACHE_LINE_SIZE) Slot final {
+    T value;
+  };
+
+  Slot _slots[NR_CPUS];
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_PER_CPU_H_
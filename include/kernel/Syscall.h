@@ -11,6 +11,10 @@
 
 namespace valkyrie::kernel {
 
+// Forward declaration
+struct SchedParam;
+struct TimeSpec;
+
 enum Syscall {
   SYS_READ,
   SYS_WRITE,
@@ -36,6 +40,14 @@ enum Syscall {
   SYS_MMAP,
   SYS_MUNMAP,
   SYS_SIGRETURN,
+  SYS_SCHED_SETSCHEDULER,
+  SYS_CLOCK_GETTIME,
+  SYS_NANOSLEEP,
+  SYS_CLONE,
+  SYS_WAITPID,
+  SYS_FUTEX,
+  SYS_DUP,
+  SYS_DUP2,
   __NR_syscall
 };
 
@@ -69,6 +81,14 @@ void __user *sys_mmap(void __user *addr, size_t len, int prot, int flags, int fd
                       int file_offset);
 int sys_munmap(void __user *addr, size_t len);
 int sys_sigreturn();
+int sys_sched_setscheduler(pid_t pid, int policy, const SchedParam __user *param);
+int sys_clock_gettime(int clockid, TimeSpec __user *tp);
+int sys_nanosleep(const TimeSpec __user *req, TimeSpec __user *rem);
+int sys_clone(unsigned long flags, void __user *stack, void __user *tls);
+int sys_waitpid(pid_t pid, int __user *wstatus, int options);
+int sys_futex(int __user *uaddr, int op, int val, int __user *uaddr2, int val2);
+int sys_dup(int oldfd);
+int sys_dup2(int oldfd, int newfd);
 
 inline bool is_syscall_id_valid(const uint64_t id) {
   return id < Syscall::__NR_syscall;
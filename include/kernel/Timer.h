@@ -15,14 +15,48 @@ class ARMCoreTimer final {
   void disable();
 
   void tick();
-  void arrange_next_timer_irq_after(const uint32_t second);
 
-  uint32_t get_jiffies() const;
+  // Programs the timer to fire once CNTPCT_EL0 reaches `deadline`.
+  void arrange_next_timer_irq_at(const uint64_t deadline);
+
+  // Masks the timer IRQ until arrange_next_timer_irq_at() is called again.
+  void cancel_next_timer_irq();
+
+  // Returns the CNTPCT_EL0 value of the next periodic tick.
+  uint64_t get_next_tick() const;
+
+  uint64_t get_jiffies() const;
+
+  // The physical counter (CNTPCT_EL0) and its frequency (CNTFRQ_EL0).
+  static uint64_t get_counter() {
+    uint64_t cntpct_el0;
+    asm volatile("mrs %0, cntpct_el0" : "=r"(cntpct_el0));
+    return cntpct_el0;
+  }
+
+  static uint64_t get_frequency() {
+    uint64_t cntfrq_el0;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(cntfrq_el0));
+    return cntfrq_el0;
+  }
+
+  // Converts a number of counter ticks to nanoseconds without overflowing
+  // for large tick counts.
+  static uint64_t counter_to_ns(const uint64_t ticks) {
+    const uint64_t freq = get_frequency();
+    return (ticks / freq) * 1000000000 + (ticks % freq) * 1000000000 / freq;
+  }
+
+  static uint64_t ns_to_counter(const uint64_t ns) {
+    const uint64_t freq = get_frequency();
+    return (ns / 1000000000) * freq + (ns % 1000000000) * freq / 1000000000;
+  }
 
  private:
   bool _is_enabled;
-  uint32_t _interval;
-  uint32_t _jiffies;
+  uint64_t _interval;   // in CNTPCT_EL0 ticks
+  uint64_t _last_tick;  // CNTPCT_EL0 of the last periodic tick
+  uint64_t _jiffies;
 };
 
 }  // namespace valkyrie::kernel
@@ -2,11 +2,16 @@
 #ifndef VALKYRIE_TIMER_MULTIPLEXER_H_
 #define VALKYRIE_TIMER_MULTIPLEXER_H_
 
-#include <Deque.h>
-#include <Functional.h>
 #include <Singleton.h>
+#include <SpinLock.h>
 
+#include <kernel/CPU.h>
+#include <kernel/PerCpu.h>
 #include <kernel/Timer.h>
+#include <kernel/TimerWheel.h>
+
+// Like Linux's default timer_slack_ns.
+#define TIMER_DEFAULT_SLACK_NS 50000
 
 namespace valkyrie::kernel {
 
@@ -14,18 +19,30 @@ namespace valkyrie::kernel {
 // and one-shot executed tasks such as sleeping and timeout.
 // However, the number of the hardware timer is limited.
 // Therefore, the kernel needs a software mechanism to multiplex the timer.
+//
+// Each core has its own timer wheel (see kernel/TimerWheel.h) protected by
+// its own lock, and an event is always armed on the wheel of the core that
+// calls add_timer(). The callbacks are run without holding the lock.
 class TimerMultiplexer : public Singleton<TimerMultiplexer> {
  public:
-  struct Event {
-    using Callback = Function<void()>;
-
-    Callback callback;
-    uint32_t timeout;
-  };
+  using Event = TimerEvent;
 
+  // Runs the callbacks of all expired events of the calling core.
   void tick();
 
-  void add_timer(Event::Callback callback, const uint32_t timeout);
+  // Arms `event` to expire `timeout_ns` from now. It may be delayed by up to
+  // `slack_ns`, so that nearby expiries can be served by a single interrupt.
+  void add_timer(Event &event, const uint64_t timeout_ns,
+                 const uint64_t slack_ns = TIMER_DEFAULT_SLACK_NS);
+
+  // Arms `event` to expire at `deadline` (a CNTPCT_EL0 value).
+  void add_timer_at(Event &event, const uint64_t deadline, const uint64_t slack_ns);
+
+  void cancel_timer(Event &event);
+
+  // Programs the ARM core timer for the earliest expiring event and,
+  // only if `need_tick` is true, for the next periodic scheduler tick.
+  void reprogram(bool need_tick);
 
   ARMCoreTimer &get_arm_core_timer();
 
@@ -33,8 +50,15 @@ class TimerMultiplexer : public Singleton<TimerMultiplexer> {
   TimerMultiplexer();
 
  private:
+  TimerWheel &get_timer_wheel();
+  SpinLock &get_timer_wheel_lock(const TimerWheel &wheel);
+
+  // The same as cancel_timer(), but the caller must hold the wheel's lock.
+  void do_cancel_timer(Event &event);
+
   ARMCoreTimer _arm_core_timer;
-  Deque<Event> _events;
+  DEFINE_PER_CPU(TimerWheel, _timer_wheels);
+  DEFINE_PER_CPU(SpinLock, _timer_wheel_locks);
 };
 
 }  // namespace valkyrie::kernel
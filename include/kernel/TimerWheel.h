@@ -0,0 +1,124 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// TimerWheel.h - A hashed hierarchical timing wheel.
+//
+// Pending timer events are hashed by their CNTPCT_EL0 deadline into one of
+// TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots each. A level 0 slot
+// spans 2^TIMER_WHEEL_GRANULARITY_BITS counter ticks, and each level above
+// it is TIMER_WHEEL_SLOTS times coarser. Every slot is an intrusive list and
+// every level keeps a bitmap of its non-empty slots, so adding or cancelling
+// an event is O(1), and finding the next pending slot is a bitmap scan.
+// When the wheel's clock reaches a slot of a higher level, the events in it
+// are cascaded into the lower levels.
+//
+// Events keep their exact deadlines, so the core timer is programmed for
+// the exact expiry of the earliest event rather than for a slot boundary.
+//
+// Reference:
+// [1] George Varghese and Tony Lauck. Hashed and Hierarchical Timing Wheels:
+//     Data Structures for the Efficient Implementation of a Timer Facility.
+#ifndef VALKYRIE_TIMER_WHEEL_H_
+#define VALKYRIE_TIMER_WHEEL_H_
+
+#include <Bitmap.h>
+#include <Functional.h>
+#include <IntrusiveList.h>
+#include <TypeTraits.h>
+#include <Types.h>
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_GRANULARITY_BITS 12 /* 4096 counter ticks per level 0 slot */
+
+namespace valkyrie::kernel {
+
+// Forward declaration
+class TimerWheel;
+class TimerMultiplexer;
+
+// A timer event is embedded in its owner (e.g., a sleeping task's stack frame),
+// so arming it never allocates. If it's destroyed while pending, it is cancelled.
+class TimerEvent {
+  MAKE_NONCOPYABLE(TimerEvent);
+  MAKE_NONMOVABLE(TimerEvent);
+
+  // Friend declaration
+  friend class TimerWheel;
+  friend class TimerMultiplexer;
+
+ public:
+  using Callback = Function<void()>;
+
+  TimerEvent();
+  explicit TimerEvent(Callback callback);
+  ~TimerEvent();
+
+  bool is_pending() const {
+    return _node.is_linked();
+  }
+
+  Callback callback;
+  uint64_t deadline;  // CNTPCT_EL0 value at which the event expires
+  uint64_t slack;     // CNTPCT_EL0 ticks it may be delayed by, so expiries can coalesce
+
+ private:
+  TimerWheel *_wheel;
+  uint8_t _level;
+  uint8_t _slot;
+  IntrusiveListNode _node;
+};
+
+class TimerWheel {
+  MAKE_NONCOPYABLE(TimerWheel);
+  MAKE_NONMOVABLE(TimerWheel);
+
+ public:
+  using EventList = IntrusiveList<TimerEvent, &TimerEvent::_node>;
+
+  TimerWheel();
+  ~TimerWheel() = default;
+
+  void add(TimerEvent &event);
+  void remove(TimerEvent &event);
+
+  // Advances the wheel's clock to `now`, and moves all the events whose
+  // deadlines are no later than `now` to `expired`.
+  void collect_expired(const uint64_t now, EventList &expired);
+
+  // Returns the CNTPCT_EL0 value at which the core timer should fire next,
+  // taking slack into account, or `npos` if there are no pending events.
+  uint64_t get_next_expiry() const;
+
+  static constexpr const uint64_t npos = static_cast<uint64_t>(-1);
+
+ private:
+  static uint64_t to_granule(const uint64_t counter) {
+    return counter >> TIMER_WHEEL_GRANULARITY_BITS;
+  }
+
+  static uint64_t to_counter(const uint64_t granule) {
+    return granule << TIMER_WHEEL_GRANULARITY_BITS;
+  }
+
+  void insert(TimerEvent &event);
+
+  // Returns the absolute slot number (i.e., granule >> (level * TIMER_WHEEL_SLOT_BITS))
+  // of the first non-empty slot of `level` that hasn't been processed, or `npos`.
+  uint64_t find_next_pending_slot(const int level) const;
+
+  // Returns the first granule at which some slot has to be processed, or `npos`.
+  uint64_t find_next_pending_granule() const;
+
+  void process_granule(const uint64_t now, EventList &expired);
+  void cascade(const int level, const size_t slot);
+
+  uint64_t _clk;  // the next granule to process
+  size_t _nr_events;
+  EventList _slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+  Bitmap<TIMER_WHEEL_SLOTS> _pending[TIMER_WHEEL_LEVELS];
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_TIMER_WHEEL_H_
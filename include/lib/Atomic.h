@@ -1,51 +1,349 @@
 // Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// Atomic.h - Lock-free atomic integers and pointers.
+//
+// Atomic<T> works on 32-bit and 64-bit integral and pointer types. Each
+// operation takes a MemoryOrder, which maps onto the AArch64 instructions
+// as follows:
+//
+//   load()           RELAXED: LDR,  otherwise LDAR
+//   store()          RELAXED: STR,  otherwise STLR
+//   read-modify-write         LD{A}XR/ST{L}XR loop, where ACQUIRE adds the
+//                             A and RELEASE adds the L (both for ACQ_REL
+//                             and SEQ_CST)
+//
+// If the compiler targets ARMv8.1 or above (__ARM_FEATURE_ATOMICS), the
+// read-modify-write operations use the LSE instructions (SWP, CAS, LDADD,
+// LDSET, LDCLR) instead, which never have to retry.
+//
 // WARNING: DO NOT USE THIS WITHOUT VIRTUAL MEMORY
+// Exclusive loads/stores are only guaranteed to work on Normal memory,
+// which is what all RAM is mapped as once the MMU is enabled.
 #ifndef VALKYRIE_ATOMIC_H_
 #define VALKYRIE_ATOMIC_H_
 
 #include <TypeTraits.h>
-#include <Utility.h>
+#include <Types.h>
+
+// Expands `OP(acquire_suffix, release_suffix, R, ...)` according to `order`,
+// where `R` is the operand modifier that selects W registers for a 32-bit
+// `T`, so that the instructions access exactly sizeof(T) bytes.
+#define ATOMIC_DISPATCH(order, OP, ...)                   \
+  do {                                                    \
+    if constexpr (sizeof(T) == 4) {                       \
+      ATOMIC_DISPATCH_ORDER(order, OP, "w", __VA_ARGS__); \
+    } else {                                              \
+      ATOMIC_DISPATCH_ORDER(order, OP, "", __VA_ARGS__);  \
+    }                                                     \
+  } while (0)
+
+#define ATOMIC_DISPATCH_ORDER(order, OP, R, ...) \
+  switch (order) {                               \
+    case MemoryOrder::RELAXED:                   \
+      OP("", "", R, __VA_ARGS__);                \
+      break;                                     \
+    case MemoryOrder::ACQUIRE:                   \
+      OP("a", "", R, __VA_ARGS__);               \
+      break;                                     \
+    case MemoryOrder::RELEASE:                   \
+      OP("", "l", R, __VA_ARGS__);               \
+      break;                                     \
+    default:                                     \
+      OP("a", "l", R, __VA_ARGS__);              \
+      break;                                     \
+  }
+
+#ifdef __ARM_FEATURE_ATOMICS
+
+#define ATOMIC_FETCH_OP(A, L, R, insn)                    \
+  asm volatile(insn A L " %" R "[arg], %" R "[old], %[v]" \
+               : [old] "=r"(old), [v] "+Q"(_v)            \
+               : [arg] "r"(arg)                           \
+               : "memory")
+
+#define ATOMIC_EXCHANGE(A, L, R, _)                        \
+  asm volatile("swp" A L " %" R "[arg], %" R "[old], %[v]" \
+               : [old] "=r"(old), [v] "+Q"(_v)             \
+               : [arg] "r"(desired)                        \
+               : "memory")
+
+#define ATOMIC_CMPXCHG(A, L, R, _)                                \
+  asm volatile("mov %" R "[old], %" R "[expected]         \n"     \
+               "cas" A L " %" R "[old], %" R "[desired], %[v] \n" \
+               : [old] "=&r"(old), [v] "+Q"(_v)                   \
+               : [expected] "r"(expected), [desired] "r"(desired) \
+               : "memory")
+
+#else
+
+#define ATOMIC_FETCH_OP(A, L, R, insn)                                                    \
+  asm volatile("1: ld" A "xr %" R "[old], %[v]          \n"                               \
+               "   " insn " %" R "[tmp], %" R "[old], %" R "[arg] \n"                     \
+               "   st" L "xr %w[status], %" R "[tmp], %[v] \n"                            \
+               "   cbnz %w[status], 1b                  \n"                               \
+               : [old] "=&r"(old), [tmp] "=&r"(tmp), [status] "=&r"(status), [v] "+Q"(_v) \
+               : [arg] "r"(arg)                                                           \
+               : "memory")
+
+#define ATOMIC_EXCHANGE(A, L, R, _)                                     \
+  asm volatile("1: ld" A "xr %" R "[old], %[v]          \n"             \
+               "   st" L "xr %w[status], %" R "[arg], %[v] \n"          \
+               "   cbnz %w[status], 1b                  \n"             \
+               : [old] "=&r"(old), [status] "=&r"(status), [v] "+Q"(_v) \
+               : [arg] "r"(desired)                                     \
+               : "memory")
+
+#define ATOMIC_CMPXCHG(A, L, R, _)                                      \
+  asm volatile("1: ld" A "xr %" R "[old], %[v]          \n"             \
+               "   cmp %" R "[old], %" R "[expected]    \n"             \
+               "   b.ne 2f                              \n"             \
+               "   st" L "xr %w[status], %" R "[desired], %[v] \n"      \
+               "   cbnz %w[status], 1b                  \n"             \
+               "   b 3f                                 \n"             \
+               "2: clrex                                \n"             \
+               "3:                                      \n"             \
+               : [old] "=&r"(old), [status] "=&r"(status), [v] "+Q"(_v) \
+               : [expected] "r"(expected), [desired] "r"(desired)       \
+               : "cc", "memory")
+
+#endif  // __ARM_FEATURE_ATOMICS
+
+// load() and store() pick the width the same way.
+#define ATOMIC_LOAD(R)                                                                   \
+  do {                                                                                   \
+    if (order == MemoryOrder::RELAXED) {                                                 \
+      asm volatile("ldr %" R "[ret], %[v]" : [ret] "=r"(ret) : [v] "Q"(_v) : "memory");  \
+    } else {                                                                             \
+      asm volatile("ldar %" R "[ret], %[v]" : [ret] "=r"(ret) : [v] "Q"(_v) : "memory"); \
+    }                                                                                    \
+  } while (0)
+
+#define ATOMIC_STORE(R)                                                                \
+  do {                                                                                 \
+    if (order == MemoryOrder::RELAXED) {                                               \
+      asm volatile("str %" R "[val], %[v]" : [v] "=Q"(_v) : [val] "r"(v) : "memory");  \
+    } else {                                                                           \
+      asm volatile("stlr %" R "[val], %[v]" : [v] "=Q"(_v) : [val] "r"(v) : "memory"); \
+    }                                                                                  \
+  } while (0)
 
 namespace valkyrie::kernel {
 
-template <typename>
-class Atomic;
+enum class MemoryOrder {
+  RELAXED,  // atomicity only, no ordering
+  ACQUIRE,  // later accesses can't be moved before it
+  RELEASE,  // earlier accesses can't be moved after it
+  ACQ_REL,  // both of the above
+  SEQ_CST,  // both of the above, and a single total order
+};
+
+template <typename T>
+class Atomic {
+  MAKE_NONCOPYABLE(Atomic);
+  MAKE_NONMOVABLE(Atomic);
+
+  static_assert(IsIntegral<T> || IsPointer<T>, "Atomic<T> needs an integral or pointer type");
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Atomic<T> only supports 32/64-bit types");
+
+ public:
+  constexpr Atomic() : _v() {}
+  constexpr Atomic(T v) : _v(v) {}
+  ~Atomic() = default;
+
+  T load(const MemoryOrder order = MemoryOrder::SEQ_CST) const {
+    T ret;
+
+    if constexpr (sizeof(T) == 4) {
+      ATOMIC_LOAD("w");
+    } else {
+      ATOMIC_LOAD("");
+    }
+
+    return ret;
+  }
+
+  void store(const T v, const MemoryOrder order = MemoryOrder::SEQ_CST) {
+    if constexpr (sizeof(T) == 4) {
+      ATOMIC_STORE("w");
+    } else {
+      ATOMIC_STORE("");
+    }
+  }
+
+  // Replaces the value with `desired` and returns the old value.
+  T exchange(const T desired, const MemoryOrder order = MemoryOrder::SEQ_CST) {
+    [[maybe_unused]] uint32_t status;
+    T old;
+
+    ATOMIC_DISPATCH(order, ATOMIC_EXCHANGE, _);
+    return old;
+  }
+
+  // If the value equals `expected`, replaces it with `desired` and returns
+  // true. Otherwise, loads the current value into `expected` and returns false.
+  bool compare_exchange(T &expected, const T desired,
+                        const MemoryOrder order = MemoryOrder::SEQ_CST) {
+    [[maybe_unused]] uint32_t status;
+    T old;
+
+    ATOMIC_DISPATCH(order, ATOMIC_CMPXCHG, _);
+
+    if (old != expected) {
+      expected = old;
+      return false;
+    }
+    return true;
+  }
+
+  // The fetch_*() operations return the old value.
+  T fetch_add(const T arg, const MemoryOrder order = MemoryOrder::SEQ_CST)
+    requires IsIntegral<T>
+  {
+    return fetch_op_add(arg, order);
+  }
+
+  T fetch_sub(const T arg, const MemoryOrder order = MemoryOrder::SEQ_CST)
+    requires IsIntegral<T>
+  {
+#ifdef __ARM_FEATURE_ATOMICS
+    return fetch_op_add(-arg, order);
+#else
+    [[maybe_unused]] uint32_t status;
+    T old, tmp;
+
+    ATOMIC_DISPATCH(order, ATOMIC_FETCH_OP, "sub");
+    return old;
+#endif
+  }
+
+  T fetch_or(const T arg, const MemoryOrder order = MemoryOrder::SEQ_CST)
+    requires IsIntegral<T>
+  {
+    [[maybe_unused]] uint32_t status;
+    [[maybe_unused]] T tmp;
+    T old;
+
+#ifdef __ARM_FEATURE_ATOMICS
+    ATOMIC_DISPATCH(order, ATOMIC_FETCH_OP, "ldset");
+#else
+    ATOMIC_DISPATCH(order, ATOMIC_FETCH_OP, "orr");
+#endif
+    return old;
+  }
+
+  T fetch_and(const T mask, const MemoryOrder order = MemoryOrder::SEQ_CST)
+    requires IsIntegral<T>
+  {
+    [[maybe_unused]] uint32_t status;
+    [[maybe_unused]] T tmp;
+    T old;
+
+#ifdef __ARM_FEATURE_ATOMICS
+    // LDCLR clears the bits which are set in its operand.
+    const T arg = ~mask;
+    ATOMIC_DISPATCH(order, ATOMIC_FETCH_OP, "ldclr");
+#else
+    const T arg = mask;
+    ATOMIC_DISPATCH(order, ATOMIC_FETCH_OP, "and");
+#endif
+    return old;
+  }
+
+  operator T() const {
+    return load();
+  }
+
+  Atomic &operator=(const T v) {
+    store(v);
+    return *this;
+  }
+
+  T operator++() requires IsIntegral<T> {
+    return fetch_add(1) + 1;
+  }
+
+  T operator--() requires IsIntegral<T> {
+    return fetch_sub(1) - 1;
+  }
+
+  T operator++(int) requires IsIntegral<T> {
+    return fetch_add(1);
+  }
+
+  T operator--(int) requires IsIntegral<T> {
+    return fetch_sub(1);
+  }
+
+ private:
+  T fetch_op_add(const T arg, const MemoryOrder order) {
+    [[maybe_unused]] uint32_t status;
+    [[maybe_unused]] T tmp;
+    T old;
+
+#ifdef __ARM_FEATURE_ATOMICS
+    ATOMIC_DISPATCH(order, ATOMIC_FETCH_OP, "ldadd");
+#else
+    ATOMIC_DISPATCH(order, ATOMIC_FETCH_OP, "add");
+#endif
+    return old;
+  }
+
+  T _v;
+};
 
-// Partial specialization of class `Atomic`
+// Exclusives don't come in a byte-sized flavor that we'd want to bother
+// with, so a bool is stored as a 32-bit word.
 template <>
 class Atomic<bool> {
   MAKE_NONCOPYABLE(Atomic);
+  MAKE_NONMOVABLE(Atomic);
 
  public:
-  // Default constructor
-  Atomic() : _v() {}
+  constexpr Atomic() : _v() {}
+  constexpr Atomic(bool v) : _v(v) {}
+  ~Atomic() = default;
 
-  // Constructor
-  explicit Atomic(bool v) : _v(v) {}
+  bool load(const MemoryOrder order = MemoryOrder::SEQ_CST) const {
+    return _v.load(order);
+  }
 
-  // Destructor
-  ~Atomic() = default;
+  void store(const bool v, const MemoryOrder order = MemoryOrder::SEQ_CST) {
+    _v.store(v, order);
+  }
 
-  // Move constructor
-  Atomic(Atomic &&r) noexcept {
-    *this = move(r);
+  bool exchange(const bool desired, const MemoryOrder order = MemoryOrder::SEQ_CST) {
+    return _v.exchange(desired, order);
   }
 
-  // Move assignment operator
-  Atomic &operator=(Atomic &&r) noexcept {
-    static_cast<void>(__sync_lock_test_and_set(&_v, r._v));
-    return *this;
+  bool compare_exchange(bool &expected, const bool desired,
+                        const MemoryOrder order = MemoryOrder::SEQ_CST) {
+    uint32_t e = expected;
+    const bool ret = _v.compare_exchange(e, desired, order);
+    expected = e;
+    return ret;
+  }
+
+  operator bool() const {
+    return load();
   }
 
-  Atomic &operator=(bool v) {
-    static_cast<void>(__sync_lock_test_and_set(&_v, v));
+  Atomic &operator=(const bool v) {
+    store(v);
     return *this;
   }
 
  private:
-  volatile bool _v;
+  Atomic<uint32_t> _v;
 };
 
 }  // namespace valkyrie::kernel
 
+#undef ATOMIC_DISPATCH
+#undef ATOMIC_DISPATCH_ORDER
+#undef ATOMIC_FETCH_OP
+#undef ATOMIC_EXCHANGE
+#undef ATOMIC_CMPXCHG
+#undef ATOMIC_LOAD
+#undef ATOMIC_STORE
+
 #endif  // VALKYRIE_ATOMIC_H_
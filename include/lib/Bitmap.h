@@ -0,0 +1,122 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// Bitmap.h - A fixed-size bitmap backed by an array of 64-bit words.
+//
+// The find_* methods scan one word at a time and use the compiler's
+// count-leading/trailing-zeros builtins (CLZ/RBIT on AArch64), so a lookup
+// costs O(N / 64) word loads rather than O(N) bit tests.
+
+#ifndef VALKYRIE_BITMAP_H_
+#define VALKYRIE_BITMAP_H_
+
+#include <Types.h>
+
+namespace valkyrie::kernel {
+
+template <size_t N>
+class Bitmap {
+ public:
+  // Constructor
+  Bitmap() : _words() {}
+
+  // Destructor
+  ~Bitmap() = default;
+
+  void set(size_t i) {
+    _words[i / bits_per_word] |= 1ULL << (i % bits_per_word);
+  }
+
+  void clear(size_t i) {
+    _words[i / bits_per_word] &= ~(1ULL << (i % bits_per_word));
+  }
+
+  bool test(size_t i) const {
+    return _words[i / bits_per_word] & (1ULL << (i % bits_per_word));
+  }
+
+  void reset() {
+    for (size_t i = 0; i < nr_words; i++) {
+      _words[i] = 0;
+    }
+  }
+
+  bool none() const {
+    for (size_t i = 0; i < nr_words; i++) {
+      if (_words[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Returns the index of the lowest set bit, or `npos` if none.
+  size_t find_first_set() const {
+    for (size_t i = 0; i < nr_words; i++) {
+      if (_words[i]) {
+        return i * bits_per_word + __builtin_ctzll(_words[i]);
+      }
+    }
+    return npos;
+  }
+
+  // Returns the index of the lowest set bit at or after `pos`, or `npos` if none.
+  size_t find_next_set(size_t pos) const {
+    for (size_t i = pos / bits_per_word; i < nr_words; i++) {
+      uint64_t word = _words[i];
+
+      // Ignore the bits below `pos` in the first word we look at.
+      if (i == pos / bits_per_word) {
+        word &= ~0ULL << (pos % bits_per_word);
+      }
+
+      if (word) {
+        return i * bits_per_word + __builtin_ctzll(word);
+      }
+    }
+    return npos;
+  }
+
+  // Returns the index of the highest set bit, or `npos` if none.
+  size_t find_last_set() const {
+    for (size_t i = nr_words; i-- > 0;) {
+      if (_words[i]) {
+        return i * bits_per_word + (bits_per_word - 1 - __builtin_clzll(_words[i]));
+      }
+    }
+    return npos;
+  }
+
+  // Returns the index of the lowest clear bit at or after `pos`, or `npos` if none.
+  size_t find_first_zero(size_t pos = 0) const {
+    for (size_t i = pos / bits_per_word; i < nr_words; i++) {
+      uint64_t word = ~_words[i];
+
+      // Ignore the bits below `pos` in the first word we look at.
+      if (i == pos / bits_per_word) {
+        word &= ~0ULL << (pos % bits_per_word);
+      }
+
+      if (word) {
+        size_t ret = i * bits_per_word + __builtin_ctzll(word);
+        return (ret < N) ? ret : npos;
+      }
+    }
+    return npos;
+  }
+
+  static constexpr size_t size() {
+    return N;
+  }
+
+  static const size_t npos = -1;
+
+ private:
+  static constexpr const size_t bits_per_word = 64;
+  static constexpr const size_t nr_words = (N + bits_per_word - 1) / bits_per_word;
+
+  uint64_t _words[nr_words];
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_BITMAP_H_
@@ -0,0 +1,116 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// IntrusiveList.h - A doubly linked list whose links live in the elements.
+//
+// Unlike List<T>, which allocates a node for each element, an element of
+// an IntrusiveList embeds an IntrusiveListNode, so insertion never
+// allocates and an element can be unlinked in O(1) given only a reference
+// to it. The list never owns its elements.
+#ifndef VALKYRIE_INTRUSIVE_LIST_H_
+#define VALKYRIE_INTRUSIVE_LIST_H_
+
+#include <TypeTraits.h>
+#include <Types.h>
+
+namespace valkyrie::kernel {
+
+struct IntrusiveListNode {
+  MAKE_NONCOPYABLE(IntrusiveListNode);
+  MAKE_NONMOVABLE(IntrusiveListNode);
+
+  IntrusiveListNode() : prev(this), next(this) {}
+  ~IntrusiveListNode() = default;
+
+  bool is_linked() const {
+    return next != this;
+  }
+
+  void unlink() {
+    prev->next = next;
+    next->prev = prev;
+    prev = next = this;
+  }
+
+  IntrusiveListNode *prev;
+  IntrusiveListNode *next;
+};
+
+template <typename T, IntrusiveListNode T::*Member>
+class IntrusiveList {
+  MAKE_NONCOPYABLE(IntrusiveList);
+  MAKE_NONMOVABLE(IntrusiveList);
+
+ public:
+  IntrusiveList() : _head() {}
+  ~IntrusiveList() = default;
+
+  void push_back(T &t) {
+    link(&(t.*Member), _head.prev, &_head);
+  }
+
+  void push_front(T &t) {
+    link(&(t.*Member), &_head, _head.next);
+  }
+
+  void pop_front() {
+    _head.next->unlink();
+  }
+
+  static void remove(T &t) {
+    (t.*Member).unlink();
+  }
+
+  T &front() {
+    return container_of(_head.next);
+  }
+
+  bool empty() const {
+    return !_head.is_linked();
+  }
+
+  // Moves all the elements of `other` to the back of this list.
+  void splice(IntrusiveList &other) {
+    while (!other.empty()) {
+      T &t = other.front();
+      other.pop_front();
+      push_back(t);
+    }
+  }
+
+  template <typename UnaryFunction>
+  void for_each(UnaryFunction f) {
+    for (IntrusiveListNode *n = _head.next; n != &_head; n = n->next) {
+      f(container_of(n));
+    }
+  }
+
+  template <typename UnaryFunction>
+  void for_each(UnaryFunction f) const {
+    for (const IntrusiveListNode *n = _head.next; n != &_head; n = n->next) {
+      f(container_of(const_cast<IntrusiveListNode *>(n)));
+    }
+  }
+
+ private:
+  static void link(IntrusiveListNode *node, IntrusiveListNode *prev, IntrusiveListNode *next) {
+    next->prev = node;
+    node->next = next;
+    node->prev = prev;
+    prev->next = node;
+  }
+
+  static T &container_of(IntrusiveListNode *node) {
+    // Like offsetof(), but for a pointer to data member.
+    constexpr size_t base = alignof(T);
+    const size_t offset =
+        reinterpret_cast<size_t>(&(reinterpret_cast<T *>(base)->*Member)) - base;
+
+    return *reinterpret_cast<T *>(reinterpret_cast<char *>(node) - offset);
+  }
+
+  IntrusiveListNode _head;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_INTRUSIVE_LIST_H_
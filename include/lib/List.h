@@ -129,13 +129,16 @@ class List {
   }
 
   void remove_if(Function<bool(T &)> predicate, bool check_all = false) {
-    for (Node *node = _head->next; node != _head.get(); node = node->next) {
+    Node *node = _head->next;
+    while (node != _head.get()) {
+      Node *next = node->next;
       if (predicate(node->data)) {
         list_del_entry(node);
         if (!check_all) {
           return;
         }
       }
+      node = next;
     }
   }
 
@@ -6,18 +6,39 @@
 #define VALKYRIE_MUTEX_H_
 
 #include <kernel/Exception.h>
+#include <proc/Preempt.h>
 
 namespace valkyrie::kernel {
 
+// Kernel::mutex, the big kernel lock. It only disables IRQs, so it's only
+// good for a single core. New code should use a lock of its own subsystem
+// (see include/lib/SpinLock.h) instead.
+//
+// A task may go to sleep while holding it (e.g., in WaitQueue::sleep()),
+// so the hold belongs to the task, and the task scheduler swaps it on every
+// context switch (see HolderState below).
 class RecursiveMutex {
  public:
-  RecursiveMutex() : _is_locked(), _depth() {}
+  // How deep the current task is in the mutex, and its DAIF before the
+  // outermost lock(). Saved into the Task while it's switched out.
+  struct HolderState final {
+    int depth;
+    size_t saved_daif;
+  };
+
+  RecursiveMutex() : _is_locked(), _depth(), _saved_daif() {}
   ~RecursiveMutex() = default;
 
   // Locks the mutex, blocks if the mutex is not available
   void lock() {
     if (exception::is_activated()) [[likely]] {
-      exception::disable_irqs();
+      const size_t daif = exception::save_and_disable_irqs();
+
+      // Only the outermost lock() knows whether IRQs were enabled before.
+      if (!_depth) {
+        _saved_daif = daif;
+      }
+
       _is_locked = true;
       _depth++;
     }
@@ -28,7 +49,10 @@ class RecursiveMutex {
     if (exception::is_activated()) [[likely]] {
       if (!--_depth) {
         _is_locked = false;
-        exception::enable_irqs();
+        exception::restore_irqs(_saved_daif);
+
+        // Someone may have woken up a higher-priority task in the meantime.
+        preempt_check_resched();
       }
     }
 
@@ -39,9 +63,21 @@ class RecursiveMutex {
     }
   }
 
+  // Replaces the current task's hold on the mutex with `state`,
+  // and returns the previous one. Only for the task scheduler.
+  HolderState exchange_holder_state(const HolderState &state) {
+    const HolderState prev = {_depth, _saved_daif};
+
+    _is_locked = state.depth > 0;
+    _depth = state.depth;
+    _saved_daif = state.saved_daif;
+    return prev;
+  }
+
  private:
   bool _is_locked;
   int _depth;
+  size_t _saved_daif;  // DAIF before the outermost lock()
 };
 
 template <typename T>
@@ -0,0 +1,251 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// RadixTree.h - A sparse map from integer indices to pointers.
+//
+// Each node has 64 slots, and an index is consumed 6 bits at a time, from
+// the most significant end. The tree is only as tall as the largest index
+// requires, so a lookup in a tree that holds the first 64 indices is a
+// single array access. Interior nodes are allocated on demand, and freed
+// once they become empty.
+//
+// The tree doesn't own the items, and nullptr can't be stored.
+#ifndef VALKYRIE_RADIX_TREE_H_
+#define VALKYRIE_RADIX_TREE_H_
+
+#include <TypeTraits.h>
+#include <Types.h>
+
+namespace valkyrie::kernel {
+
+template <typename T>
+class RadixTree {
+  MAKE_NONCOPYABLE(RadixTree);
+  MAKE_NONMOVABLE(RadixTree);
+
+ public:
+  // Constructor
+  RadixTree() : _root(), _height() {}
+
+  // Destructor
+  ~RadixTree() {
+    clear();
+  }
+
+  T *get(size_t index) const {
+    if (index > max_index(_height)) {
+      return nullptr;
+    }
+
+    void *slot = _root;
+
+    for (size_t level = _height; slot && level > 0; level--) {
+      slot = static_cast<Node *>(slot)->slots[slot_index(index, level)];
+    }
+
+    return static_cast<T *>(slot);
+  }
+
+  // Returns false if `index` is taken, or if a node can't be allocated.
+  [[nodiscard]] bool insert(size_t index, T *item) {
+    if (!item) [[unlikely]] {
+      return false;
+    }
+
+    // Grow the tree from the top until `index` fits.
+    while (index > max_index(_height)) {
+      if (_root) {
+        auto node = new Node();
+
+        if (!node) [[unlikely]] {
+          return false;
+        }
+
+        node->slots[0] = _root;
+        node->count = 1;
+        _root = node;
+      }
+      _height++;
+    }
+
+    void **slot = &_root;
+
+    for (size_t level = _height; level > 0; level--) {
+      if (!*slot) {
+        auto node = new Node();
+
+        if (!node) [[unlikely]] {
+          return false;
+        }
+
+        *slot = node;
+
+        // Account for the new node in its parent, unless it's the root.
+        if (level < _height) {
+          parent_of(index, level)->count++;
+        }
+      }
+
+      slot = &static_cast<Node *>(*slot)->slots[slot_index(index, level)];
+    }
+
+    if (*slot) {
+      return false;
+    }
+
+    *slot = item;
+
+    if (_height > 0) {
+      parent_of(index, 0)->count++;
+    }
+
+    return true;
+  }
+
+  // Removes and returns the item at `index`, or nullptr if none.
+  T *remove(size_t index) {
+    if (index > max_index(_height) || !_root) {
+      return nullptr;
+    }
+
+    if (_height == 0) {
+      return static_cast<T *>(exchange_root(nullptr));
+    }
+
+    // Remember the path, so that the nodes which become empty can be freed.
+    Node *path[max_height + 1] = {};
+    Node *node = static_cast<Node *>(_root);
+
+    for (size_t level = _height; level > 1; level--) {
+      path[level] = node;
+      node = static_cast<Node *>(node->slots[slot_index(index, level)]);
+
+      if (!node) {
+        return nullptr;
+      }
+    }
+    path[1] = node;
+
+    void *&leaf_slot = node->slots[slot_index(index, 1)];
+    void *item = leaf_slot;
+
+    if (!item) {
+      return nullptr;
+    }
+
+    leaf_slot = nullptr;
+
+    for (size_t level = 1; level <= _height; level++) {
+      if (--path[level]->count > 0) {
+        break;
+      }
+
+      delete path[level];
+
+      if (level == _height) {
+        _root = nullptr;
+        _height = 0;
+      } else {
+        path[level + 1]->slots[slot_index(index, level + 1)] = nullptr;
+      }
+    }
+
+    return static_cast<T *>(item);
+  }
+
+  // Invokes `f(index, item)` on each item, in ascending order of their indices.
+  template <typename UnaryFunction>
+  void for_each(UnaryFunction f) const {
+    for_each_impl(_root, _height, 0, f);
+  }
+
+  // Removes all the items, without touching the items themselves.
+  void clear() {
+    clear_impl(_root, _height);
+    _root = nullptr;
+    _height = 0;
+  }
+
+  bool empty() const {
+    return !_root;
+  }
+
+ private:
+  static constexpr const size_t bits_per_level = 6;
+  static constexpr const size_t nr_slots = 1 << bits_per_level;
+  static constexpr const size_t max_height = (64 + bits_per_level - 1) / bits_per_level;
+
+  struct Node final {
+    Node() : slots(), count() {}
+
+    void *slots[nr_slots];
+    size_t count;  // the number of non-null slots
+  };
+
+  // The largest index a tree of `height` levels can hold.
+  static size_t max_index(size_t height) {
+    if (height * bits_per_level >= 64) {
+      return static_cast<size_t>(-1);
+    }
+    return (1UL << (height * bits_per_level)) - 1;
+  }
+
+  // The slot that `index` goes through in a node of `level` (1 being the leaves).
+  static size_t slot_index(size_t index, size_t level) {
+    return (index >> ((level - 1) * bits_per_level)) & (nr_slots - 1);
+  }
+
+  // The node of `level + 1` on the path to `index`, which must exist.
+  Node *parent_of(size_t index, size_t level) const {
+    Node *node = static_cast<Node *>(_root);
+
+    for (size_t l = _height; l > level + 1; l--) {
+      node = static_cast<Node *>(node->slots[slot_index(index, l)]);
+    }
+    return node;
+  }
+
+  void *exchange_root(void *root) {
+    void *ret = _root;
+    _root = root;
+    return ret;
+  }
+
+  template <typename UnaryFunction>
+  static void for_each_impl(void *slot, size_t level, size_t base, UnaryFunction &f) {
+    if (!slot) {
+      return;
+    }
+
+    if (level == 0) {
+      f(base, static_cast<T *>(slot));
+      return;
+    }
+
+    auto node = static_cast<Node *>(slot);
+
+    for (size_t i = 0; i < nr_slots; i++) {
+      size_t index = base | (i << ((level - 1) * bits_per_level));
+      for_each_impl(node->slots[i], level - 1, index, f);
+    }
+  }
+
+  static void clear_impl(void *slot, size_t level) {
+    if (!slot || level == 0) {
+      return;
+    }
+
+    auto node = static_cast<Node *>(slot);
+
+    for (size_t i = 0; i < nr_slots; i++) {
+      clear_impl(node->slots[i], level - 1);
+    }
+    delete node;
+  }
+
+  void *_root;     // an item if `_height` is 0, or a Node otherwise
+  size_t _height;  // the number of levels of nodes
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_RADIX_TREE_H_
@@ -2,6 +2,7 @@
 #ifndef VALKYRIE_SHARED_PTR_H_
 #define VALKYRIE_SHARED_PTR_H_
 
+#include <Atomic.h>
 #include <Hash.h>
 #include <TypeTraits.h>
 #include <UniquePtr.h>
@@ -34,18 +35,18 @@ class SharedPtr {
   SharedPtr(nullptr_t) : _ctrl(), _alias() {}
 
   // Constructor (from a raw pointer of type T)
-  explicit SharedPtr(T *p) : _ctrl(new ControlBlock{p, 1, 0}), _alias() {
+  explicit SharedPtr(T *p) : _ctrl(new ControlBlock{p, 1, 1}), _alias() {
     maybe_enable_shared_from_this();
   }
 
   // Constructor (from an UniquePtr<T>)
   explicit SharedPtr(UniquePtr<T> &&r)
-      : _ctrl(new ControlBlock{r.release(), 1, 0}), _alias() {}
+      : _ctrl(new ControlBlock{r.release(), 1, 1}), _alias() {}
 
   // Constructor (from a WeakPtr<T>)
-  explicit SharedPtr(const WeakPtr<T> &r) : _ctrl(r._ctrl), _alias() {
-    inc_use_count();
-  }
+  // If the object has already been destroyed, the SharedPtr will be empty.
+  explicit SharedPtr(const WeakPtr<T> &r)
+      : _ctrl((r._ctrl && r._ctrl->try_inc_use_count()) ? r._ctrl : nullptr), _alias() {}
 
   // Aliasing Constructor
   // It allows us to construct a new SharedPtr instance
@@ -69,13 +70,17 @@ class SharedPtr {
 
   // Copy assignment operator
   SharedPtr &operator=(const SharedPtr &r) {
-    if (_ctrl && _ctrl->use_count > 0) {
-      reset();
+    // Take the new reference first, in case `r` is `*this`.
+    ControlBlock *ctrl = r._ctrl;
+    T *alias = r._alias;
+
+    if (ctrl) {
+      ctrl->use_count.fetch_add(1, MemoryOrder::RELAXED);
     }
 
-    _ctrl = r._ctrl;
-    _alias = r._alias;
-    inc_use_count();
+    dec_use_count();
+    _ctrl = ctrl;
+    _alias = alias;
     return *this;
   }
 
@@ -87,9 +92,7 @@ class SharedPtr {
 
   // Move assignment operator
   SharedPtr &operator=(SharedPtr &&r) noexcept {
-    if (_ctrl && _ctrl->use_count > 0) {
-      reset();
-    }
+    dec_use_count();
 
     _ctrl = r._ctrl;
     _alias = r._alias;
@@ -145,40 +148,37 @@ class SharedPtr {
   }
 
   int use_count() const {
-    return (_ctrl) ? _ctrl->use_count : 0;
+    return (_ctrl) ? _ctrl->use_count.load(MemoryOrder::RELAXED) : 0;
   }
 
  protected:
   void inc_use_count() {
     if (_ctrl) {
-      _ctrl->use_count++;
+      _ctrl->use_count.fetch_add(1, MemoryOrder::RELAXED);
     }
   }
 
+  // Drops our reference, and leaves this SharedPtr empty.
+  template <bool IsArray = false>
   void dec_use_count() {
-    if (_ctrl && _ctrl->use_count > 0) {
-      _ctrl->use_count--;
-      maybe_delete_p();
-      maybe_delete_ctrl_block();
+    if (!_ctrl) {
+      return;
     }
-  }
 
-  void maybe_delete_p() {
-    if (_ctrl && _ctrl->use_count == 0) {
-      delete _ctrl->p;
+    // The last owner must observe all the writes made by other owners
+    // before it destroys the object, hence ACQ_REL.
+    if (_ctrl->use_count.fetch_sub(1, MemoryOrder::ACQ_REL) == 1) {
+      if constexpr (IsArray) {
+        delete[] _ctrl->p;
+      } else {
+        delete _ctrl->p;
+      }
       _ctrl->p = nullptr;
+      _ctrl->dec_use_count_weak();
     }
-  }
 
-  void maybe_delete_ctrl_block() {
-    if (_ctrl && _ctrl->use_count + _ctrl->use_count_weak == 0) {
-      // Set use_count_weak to -1 to prevent against double delete.
-      // FIXME: thread safety
-      _ctrl->use_count_weak = -1;
-
-      delete _ctrl;
-      _ctrl = nullptr;
-    }
+    _ctrl = nullptr;
+    _alias = nullptr;
   }
 
   [[gnu::always_inline]] void maybe_enable_shared_from_this() const {
@@ -191,10 +191,33 @@ class SharedPtr {
     }
   }
 
+  // Both counters are atomic, so SharedPtrs to the same object may be
+  // copied and destroyed concurrently without any lock. All the owners
+  // together hold a single weak reference, so the control block is deleted
+  // when the last WeakPtr or the last owner goes away, whichever is later.
   struct ControlBlock final {
+    // Takes a new reference unless the object has already been destroyed.
+    bool try_inc_use_count() {
+      int n = use_count.load(MemoryOrder::RELAXED);
+
+      do {
+        if (!n) {
+          return false;
+        }
+      } while (!use_count.compare_exchange(n, n + 1, MemoryOrder::RELAXED));
+
+      return true;
+    }
+
+    void dec_use_count_weak() {
+      if (use_count_weak.fetch_sub(1, MemoryOrder::ACQ_REL) == 1) {
+        delete this;
+      }
+    }
+
     T *p;
-    int use_count;
-    int use_count_weak;
+    Atomic<int> use_count;
+    Atomic<int> use_count_weak;
   } * _ctrl;
 
   // For SharedPtr's aliasing constructor.
@@ -214,9 +237,7 @@ class SharedPtr<T[]> : private SharedPtr<T> {
 
   // Move assignment operator
   SharedPtr &operator=(SharedPtr &&other) noexcept {
-    if (_ctrl && _ctrl->use_count > 0) {
-      reset();
-    }
+    dec_use_count();
 
     _ctrl = other._ctrl;
     _alias = other._alias;
@@ -229,6 +250,10 @@ class SharedPtr<T[]> : private SharedPtr<T> {
     dec_use_count();
   }
 
+  void reset() {
+    dec_use_count();
+  }
+
   T &operator[](size_t i) {
     return get()[i];
   }
@@ -244,20 +269,14 @@ class SharedPtr<T[]> : private SharedPtr<T> {
   using SharedPtr<T>::operator!=;
 
   using SharedPtr<T>::get;
-  using SharedPtr<T>::reset;
   using SharedPtr<T>::swap;
   using SharedPtr<T>::use_count;
 
  private:
   using SharedPtr<T>::inc_use_count;
-  using SharedPtr<T>::dec_use_count;
-  using SharedPtr<T>::maybe_delete_ctrl_block;
 
-  void maybe_delete_p() {
-    if (_ctrl && _ctrl->use_count == 0) {
-      delete[] _ctrl->p;
-      _ctrl->p = nullptr;
-    }
+  void dec_use_count() {
+    SharedPtr<T>::template dec_use_count</*IsArray=*/true>();
   }
 
   using SharedPtr<T>::_ctrl;
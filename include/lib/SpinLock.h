@@ -0,0 +1,255 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// SpinLock.h - Busy-waiting locks for short critical sections.
+//
+// SpinLock is a ticket lock: a CPU atomically takes a ticket (the high
+// halfword) with LDAXR/STXR and waits until the owner (the low halfword)
+// reaches it, so the lock is handed out in FIFO order. RWLock lets any
+// number of readers in at once, or a single writer.
+//
+// Waiters sleep with WFE instead of hammering the bus. They're woken up
+// when the holder's store-release clears their exclusive monitor.
+//
+// A spinlock must never be held across anything that may sleep. Holding
+// one disables preemption (see include/proc/Preempt.h), since a preempted
+// holder would keep the next task spinning. If it's also taken by an IRQ
+// handler, IRQs must be disabled while holding it as well (see
+// lock_irqsave() and IrqSaveLockGuard), or the handler will spin on a lock
+// that the interrupted code can never release.
+//
+// Exclusive loads/stores only work reliably on real hardware if the lock
+// lives in Normal cacheable memory, because the BCM2837 has no global
+// exclusive monitor. QEMU doesn't have this limitation.
+#ifndef VALKYRIE_SPIN_LOCK_H_
+#define VALKYRIE_SPIN_LOCK_H_
+
+#include <TypeTraits.h>
+#include <Types.h>
+
+#include <kernel/Exception.h>
+#include <proc/Preempt.h>
+
+namespace valkyrie::kernel {
+
+class SpinLock {
+  MAKE_NONCOPYABLE(SpinLock);
+  MAKE_NONMOVABLE(SpinLock);
+
+ public:
+  SpinLock() : _val() {}
+  ~SpinLock() = default;
+
+  void lock() {
+    uint32_t ticket, tmp, status;
+
+    preempt_disable();
+    asm volatile(
+        // Take a ticket.
+        "1: ldaxr %w[ticket], %[val]           \n"
+        "   add   %w[tmp], %w[ticket], #0x10000 \n"
+        "   stxr  %w[status], %w[tmp], %[val]  \n"
+        "   cbnz  %w[status], 1b               \n"
+        // Has it been our turn already?
+        "   eor   %w[tmp], %w[ticket], %w[ticket], ror #16 \n"
+        "   cbz   %w[tmp], 3f                  \n"
+        // Otherwise, wait for the owner to reach our ticket.
+        "   sevl                               \n"
+        "2: wfe                                \n"
+        "   ldaxrh %w[status], %[val]          \n"
+        "   eor   %w[tmp], %w[status], %w[ticket], lsr #16 \n"
+        "   cbnz  %w[tmp], 2b                  \n"
+        "3:                                    \n"
+        : [ticket] "=&r"(ticket), [tmp] "=&r"(tmp), [status] "=&r"(status), [val] "+Q"(_val)
+        :
+        : "memory");
+  }
+
+  bool try_lock() {
+    uint32_t val, tmp, status;
+
+    preempt_disable();
+    asm volatile(
+        "1: ldaxr %w[val], %[lock]            \n"
+        "   eor   %w[tmp], %w[val], %w[val], ror #16 \n"
+        "   cbnz  %w[tmp], 2f                 \n"
+        "   add   %w[val], %w[val], #0x10000  \n"
+        "   stxr  %w[status], %w[val], %[lock] \n"
+        "   cbnz  %w[status], 1b              \n"
+        "   b     3f                          \n"
+        "2: clrex                             \n"
+        "3:                                   \n"
+        : [val] "=&r"(val), [tmp] "=&r"(tmp), [status] "=&r"(status), [lock] "+Q"(_val)
+        :
+        : "memory");
+
+    if (tmp) {
+      preempt_enable();
+      return false;
+    }
+    return true;
+  }
+
+  void unlock() {
+    uint32_t owner;
+
+    // Only the holder writes the owner halfword, so a plain load is fine.
+    asm volatile(
+        "   ldrh  %w[owner], %[val]           \n"
+        "   add   %w[owner], %w[owner], #1    \n"
+        "   stlrh %w[owner], %[val]           \n"
+        : [owner] "=&r"(owner), [val] "+Q"(_val)
+        :
+        : "memory");
+    preempt_enable();
+  }
+
+  bool is_locked() const {
+    const uint32_t val = __atomic_load_n(&_val, __ATOMIC_RELAXED);
+    return (val >> 16) != (val & 0xffff);
+  }
+
+  // Disables IRQs before taking the lock. Returns the previous DAIF,
+  // which must be passed to unlock_irqrestore().
+  [[nodiscard]] size_t lock_irqsave() {
+    const size_t flags = exception::save_and_disable_irqs();
+    lock();
+    return flags;
+  }
+
+  // A reschedule can't happen in unlock() with IRQs still disabled,
+  // so check again once they have been restored.
+  void unlock_irqrestore(const size_t flags) {
+    unlock();
+    exception::restore_irqs(flags);
+    preempt_check_resched();
+  }
+
+ private:
+  uint32_t _val;  // next ticket (high halfword) | owner (low halfword)
+};
+
+// Readers are never blocked by waiting writers, so heavy read traffic
+// may starve a writer. Only use it where writes are rare (e.g., mount()).
+class RWLock {
+  MAKE_NONCOPYABLE(RWLock);
+  MAKE_NONMOVABLE(RWLock);
+
+ public:
+  RWLock() : _val() {}
+  ~RWLock() = default;
+
+  // Exclusive (writer) side.
+  void lock() {
+    uint32_t tmp, status;
+
+    preempt_disable();
+    asm volatile(
+        "   sevl                              \n"
+        "1: wfe                               \n"
+        "2: ldaxr %w[tmp], %[val]             \n"
+        "   cbnz  %w[tmp], 1b                 \n"
+        "   stxr  %w[status], %w[writer], %[val] \n"
+        "   cbnz  %w[status], 2b              \n"
+        : [tmp] "=&r"(tmp), [status] "=&r"(status), [val] "+Q"(_val)
+        : [writer] "r"(writer_bit)
+        : "memory");
+  }
+
+  void unlock() {
+    asm volatile("stlr wzr, %[val]" : [val] "=Q"(_val) : : "memory");
+    preempt_enable();
+  }
+
+  // Shared (reader) side.
+  void lock_shared() {
+    uint32_t tmp, status;
+
+    preempt_disable();
+    asm volatile(
+        "   sevl                              \n"
+        "1: wfe                               \n"
+        "2: ldaxr %w[tmp], %[val]             \n"
+        "   tbnz  %w[tmp], #31, 1b            \n"
+        "   add   %w[tmp], %w[tmp], #1        \n"
+        "   stxr  %w[status], %w[tmp], %[val] \n"
+        "   cbnz  %w[status], 2b              \n"
+        : [tmp] "=&r"(tmp), [status] "=&r"(status), [val] "+Q"(_val)
+        :
+        : "memory");
+  }
+
+  void unlock_shared() {
+    uint32_t tmp, status;
+
+    asm volatile(
+        "1: ldxr  %w[tmp], %[val]             \n"
+        "   sub   %w[tmp], %w[tmp], #1        \n"
+        "   stlxr %w[status], %w[tmp], %[val] \n"
+        "   cbnz  %w[status], 1b              \n"
+        : [tmp] "=&r"(tmp), [status] "=&r"(status), [val] "+Q"(_val)
+        :
+        : "memory");
+    preempt_enable();
+  }
+
+ private:
+  static constexpr const uint32_t writer_bit = 1U << 31;
+
+  uint32_t _val;  // writer_bit | number of readers
+};
+
+template <typename T>
+class SharedLockGuard {
+ public:
+  SharedLockGuard(T &t) : _t(t) {
+    _t.lock_shared();
+  }
+
+  ~SharedLockGuard() {
+    _t.unlock_shared();
+  }
+
+ private:
+  T &_t;
+};
+
+// Like LockGuard, but keeps IRQs disabled while the lock is held.
+template <typename T>
+class IrqSaveLockGuard {
+ public:
+  IrqSaveLockGuard(T &t) : _t(t), _flags(exception::save_and_disable_irqs()) {
+    _t.lock();
+  }
+
+  ~IrqSaveLockGuard() {
+    _t.unlock();
+    exception::restore_irqs(_flags);
+    preempt_check_resched();
+  }
+
+ private:
+  T &_t;
+  const size_t _flags;
+};
+
+template <typename T>
+class IrqSaveSharedLockGuard {
+ public:
+  IrqSaveSharedLockGuard(T &t) : _t(t), _flags(exception::save_and_disable_irqs()) {
+    _t.lock_shared();
+  }
+
+  ~IrqSaveSharedLockGuard() {
+    _t.unlock_shared();
+    exception::restore_irqs(_flags);
+    preempt_check_resched();
+  }
+
+ private:
+  T &_t;
+  const size_t _flags;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_SPIN_LOCK_H_
@@ -24,6 +24,12 @@ class String {
     strcpy(_s.get(), s);
   }
 
+  // Copies the first `len` chars of `s`, which needn't be null-terminated.
+  String(const char *s, size_t len) : _s(make_unique<char[]>(len + 1)) {
+    memcpy(_s.get(), s, len);
+    _s[len] = 0;
+  }
+
   // Destructor
   ~String() = default;
 
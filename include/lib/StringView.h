@@ -0,0 +1,127 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// StringView.h - A non-owning reference to a sequence of characters.
+//
+// A StringView is a pointer and a length, so taking a substring of it is
+// free, and it needn't be null-terminated. The characters must outlive it.
+#ifndef VALKYRIE_STRING_VIEW_H_
+#define VALKYRIE_STRING_VIEW_H_
+
+#include <CString.h>
+#include <Hash.h>
+#include <String.h>
+#include <Types.h>
+
+namespace valkyrie::kernel {
+
+class StringView {
+ public:
+  constexpr StringView() : _data(), _size() {}
+  constexpr StringView(const char *data, size_t size) : _data(data), _size(size) {}
+
+  StringView(const char *s) : _data(s), _size((s) ? strlen(s) : 0) {}
+  StringView(const String &s) : StringView(s.c_str()) {}
+
+  ~StringView() = default;
+
+  bool operator==(const StringView &r) const {
+    return _size == r._size && !memcmp(_data, r._data, _size);
+  }
+
+  bool operator!=(const StringView &r) const {
+    return !(*this == r);
+  }
+
+  const char &operator[](size_t i) const {
+    return _data[i];
+  }
+
+  const char *begin() const {
+    return _data;
+  }
+
+  const char *end() const {
+    return _data + _size;
+  }
+
+  const char &front() const {
+    return _data[0];
+  }
+
+  const char &back() const {
+    return _data[_size - 1];
+  }
+
+  const char *data() const {
+    return _data;
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+  bool empty() const {
+    return _size == 0;
+  }
+
+  StringView substr(size_t begin, size_t len = npos) const {
+    if (begin > _size) {
+      begin = _size;
+    }
+
+    // Sanitize `len`.
+    if (len == npos || begin + len > _size) {
+      len = _size - begin;
+    }
+
+    return {_data + begin, len};
+  }
+
+  size_t find_first_of(char c, size_t pos = 0) const {
+    for (size_t i = pos; i < _size; i++) {
+      if (_data[i] == c) {
+        return i;
+      }
+    }
+    return npos;
+  }
+
+  size_t find_first_not_of(char c, size_t pos = 0) const {
+    for (size_t i = pos; i < _size; i++) {
+      if (_data[i] != c) {
+        return i;
+      }
+    }
+    return npos;
+  }
+
+  // Copies the characters into a String, which allocates.
+  String to_string() const {
+    return String(_data, _size);
+  }
+
+  static const size_t npos = -1;
+
+ private:
+  const char *_data;
+  size_t _size;
+};
+
+// Explicit (full) specialization of `struct Hash` for StringView.
+// It yields the same hash as Hash<String> does for the same characters.
+template <>
+struct Hash<StringView> final {
+  size_t operator()(const StringView &s) const {
+    constexpr size_t prime = 19;
+    size_t ret = 5;
+
+    for (auto c : s) {
+      ret += prime * hash(c);
+    }
+    return ret;
+  }
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_STRING_VIEW_H_
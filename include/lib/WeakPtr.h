@@ -39,12 +39,15 @@ class WeakPtr {
 
   // Copy assignment operator
   WeakPtr &operator=(const WeakPtr &r) {
-    if (_ctrl && _ctrl->use_count_weak > 0) {
-      dec_use_count_weak();
+    // Take the new reference first, in case `r` is `*this`.
+    auto ctrl = r._ctrl;
+
+    if (ctrl) {
+      ctrl->use_count_weak.fetch_add(1, MemoryOrder::RELAXED);
     }
 
-    _ctrl = r._ctrl;
-    inc_use_count_weak();
+    dec_use_count_weak();
+    _ctrl = ctrl;
     return *this;
   }
 
@@ -55,9 +58,7 @@ class WeakPtr {
 
   // Move assignment operator
   WeakPtr &operator=(WeakPtr &&r) {
-    if (_ctrl && _ctrl->use_count_weak > 0) {
-      dec_use_count_weak();
-    }
+    dec_use_count_weak();
 
     _ctrl = r._ctrl;
     r._ctrl = nullptr;
@@ -79,7 +80,7 @@ class WeakPtr {
   }
 
   int use_count() const {
-    return (_ctrl) ? _ctrl->use_count : 0;
+    return (_ctrl) ? _ctrl->use_count.load(MemoryOrder::RELAXED) : 0;
   }
 
   bool expired() const {
@@ -87,30 +88,20 @@ class WeakPtr {
   }
 
   SharedPtr<T> lock() const {
-    return expired() ? SharedPtr<T>() : SharedPtr<T>(*this);
+    return SharedPtr<T>(*this);
   }
 
  protected:
   void inc_use_count_weak() {
     if (_ctrl) {
-      _ctrl->use_count_weak++;
+      _ctrl->use_count_weak.fetch_add(1, MemoryOrder::RELAXED);
     }
   }
 
+  // Drops our weak reference, and leaves this WeakPtr empty.
   void dec_use_count_weak() {
-    if (_ctrl && _ctrl->use_count_weak > 0) {
-      _ctrl->use_count_weak--;
-      maybe_delete_ctrl_block();
-    }
-  }
-
-  void maybe_delete_ctrl_block() {
-    if (_ctrl && _ctrl->use_count + _ctrl->use_count_weak == 0) {
-      // Set use_count_weak to -1 to prevent against double delete.
-      // FIXME: thread safety
-      _ctrl->use_count_weak = -1;
-
-      delete _ctrl;
+    if (_ctrl) {
+      _ctrl->dec_use_count_weak();
       _ctrl = nullptr;
     }
   }
@@ -2,8 +2,10 @@
 #ifndef VALKYRIE_MEMORY_MANAGER_H_
 #define VALKYRIE_MEMORY_MANAGER_H_
 
+#include <Atomic.h>
 #include <Mutex.h>
 #include <Singleton.h>
+#include <SpinLock.h>
 #include <String.h>
 
 #include <mm/AddressSanitizer.h>
@@ -39,13 +41,18 @@ class MemoryManager : public Singleton<MemoryManager> {
  private:
   int get_page_ref_idx(const void *p_addr) const;
 
+  void mark_allocated(void *p);
+  void mark_free_chk(void *p);
+
   const size_t _ram_size;
   Zone _zones[2];
 
   // XXX: Copy on write, refactor this
-  int _ref_counts[MAX_ORDER_NR_PAGES];
+  Atomic<int> _ref_counts[MAX_ORDER_NR_PAGES];
   bool _page_writable[MAX_ORDER_NR_PAGES];
 
+  // Shared by both zones, so it has its own lock. Always taken after a zone lock.
+  mutable SpinLock _kasan_lock;
   AddressSanitizer _kasan;
 };
 
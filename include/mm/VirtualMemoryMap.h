@@ -35,7 +35,8 @@ class VMMap final {
   // @attr:   page attribute; see include/mm/mmu.h
   void map(const size_t v_addr, const void *const p_addr, size_t attr) const;
 
-  // Unmaps a single page.
+  // Unmaps a single page, and frees its page frame
+  // if nothing else maps it or keeps it in the page cache.
   void unmap(const size_t v_addr) const;
 
   // Is copy-on-write page?
@@ -44,7 +45,8 @@ class VMMap final {
   // Gets the physical address from a virtual address by parsing the page table.
   void *get_physical_address(const size_t v_addr) const;
 
-  // Gets an unmapped area whose gap is greater or equal to len.
+  // Gets an unmapped area whose gap is greater or equal to len,
+  // or returns 0 if there's none.
   size_t get_unmapped_area(size_t len) const;
 
   // Duplicates the page frame and update relevant PTEs.
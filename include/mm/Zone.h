@@ -9,6 +9,8 @@
 #ifndef VALKYRIE_ZONE_H_
 #define VALKYRIE_ZONE_H_
 
+#include <SpinLock.h>
+
 #include <mm/BuddyAllocator.h>
 #include <mm/SlobAllocator.h>
 
@@ -18,7 +20,8 @@ struct Zone final {
   explicit Zone(const size_t begin_addr)
       : begin_addr(begin_addr),
         buddy_allocator(begin_addr),
-        slob_allocator(&buddy_allocator) {}
+        slob_allocator(&buddy_allocator),
+        lock() {}
 
   // Returns the number of pages in each zone.
   static constexpr size_t get_pages_count() {
@@ -29,6 +32,10 @@ struct Zone final {
   const size_t begin_addr;
   BuddyAllocator buddy_allocator;
   SlobAllocator slob_allocator;
+
+  // Protects both allocators of this zone. It may be taken from IRQ context,
+  // so it must be held with IRQs disabled.
+  mutable SpinLock lock;
 };
 
 }  // namespace valkyrie::kernel
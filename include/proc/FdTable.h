@@ -0,0 +1,72 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// FdTable.h - Per-process file descriptor table.
+//
+// Tasks cloned with CLONE_FILES share a single table, so it has a lock of
+// its own. The lock is never held while a file is being closed. The files
+// that are still open when the last reference to the table is dropped are
+// closed by its destructor.
+//
+// The table starts with room for NR_TASK_FD_INIT fds, and doubles its size
+// whenever it runs out, up to NR_TASK_FD_LIMITS. The fds in use are tracked
+// in a bitmap, so the lowest free fd is found with a few ctz instructions
+// rather than by testing each slot.
+#ifndef VALKYRIE_FD_TABLE_H_
+#define VALKYRIE_FD_TABLE_H_
+
+#include <Bitmap.h>
+#include <Memory.h>
+#include <SpinLock.h>
+#include <TypeTraits.h>
+
+#include <fs/File.h>
+
+#define NR_TASK_FD_INIT 16
+#define NR_TASK_FD_LIMITS 1024
+
+namespace valkyrie::kernel {
+
+class FdTable {
+  MAKE_NONCOPYABLE(FdTable);
+  MAKE_NONMOVABLE(FdTable);
+
+ public:
+  FdTable();
+  ~FdTable() = default;
+
+  // Returns the lowest free fd, or -1 if the table is full.
+  int allocate(SharedPtr<File> file);
+
+  // Makes `fd` refer to `file`, closing the file it referred to, if any.
+  // Returns `fd`, or -1 if it's out of range.
+  int install(const int fd, SharedPtr<File> file);
+
+  SharedPtr<File> release(const int fd);
+  SharedPtr<File> get(const int fd) const;
+
+  // Returns the lowest fd in use at or after `fd`, or -1 if none.
+  int find_next_used(const int fd) const;
+
+  // Makes each fd of this table refer to the same open file
+  // description as in `other`, e.g., on fork().
+  [[nodiscard]] bool copy_from(const FdTable &other);
+
+  static bool is_valid(const int fd) {
+    return fd >= 0 && fd < NR_TASK_FD_LIMITS;
+  }
+
+ private:
+  // Grows `_files` so that it holds at least `capacity` fds.
+  // The caller must hold `_lock`.
+  [[nodiscard]] bool reserve(size_t capacity);
+
+  mutable SpinLock _lock;
+  UniquePtr<SharedPtr<File>[]> _files;
+  size_t _capacity;
+  Bitmap<NR_TASK_FD_LIMITS> _used_fds;
+  int _next_fd;  // no fd below it is free
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_FD_TABLE_H_
@@ -0,0 +1,73 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// FpSimd.h - Lazy FP/SIMD context switching.
+//
+// The kernel is built with -mgeneral-regs-only, so the FP/SIMD registers
+// only ever hold user state, and most tasks never touch them at all.
+// Instead of saving and restoring 512+ bytes on every context switch, the
+// registers are left alone, and each core remembers whose state they hold
+// (the owner). Access to them is trapped (CPACR_EL1.FPEN) whenever any other
+// task is running, and only when such a task actually uses FP/SIMD is the
+// owner's state saved and the current task's state loaded in its place.
+//
+// A task's save area is allocated on its first FP/SIMD access.
+//
+// This relies on NR_CPUS being 1. With more cores, a task which migrates
+// would have to take its state along with it.
+#ifndef VALKYRIE_FP_SIMD_H_
+#define VALKYRIE_FP_SIMD_H_
+
+#include <Memory.h>
+#include <TypeTraits.h>
+#include <Types.h>
+
+namespace valkyrie::kernel {
+
+struct alignas(16) FpSimdState final {
+  __uint128_t v[32];
+  uint32_t fpsr;
+  uint32_t fpcr;
+};
+
+// See proc/fpsimd.S
+extern "C" void fpsimd_save_state(FpSimdState *state);
+extern "C" void fpsimd_load_state(const FpSimdState *state);
+
+class FpSimdContext {
+  MAKE_NONCOPYABLE(FpSimdContext);
+  MAKE_NONMOVABLE(FpSimdContext);
+
+ public:
+  FpSimdContext();
+  ~FpSimdContext();
+
+  // Called by the task scheduler before switching to the task that owns
+  // `next`. Allows FP/SIMD access iff the registers already hold its state.
+  static void switch_to(const FpSimdContext &next);
+
+  // Called on the first FP/SIMD access of the current task since it has
+  // been switched in. Loads its state into the registers.
+  // Returns false if out of memory.
+  [[nodiscard]] bool load();
+
+  // Copies the state of `other`, which must belong to the current task.
+  // Returns false if out of memory.
+  [[nodiscard]] bool copy_from(const FpSimdContext &other);
+
+  // Discards the state, e.g., on exec().
+  void reset();
+
+  bool is_used() const {
+    return static_cast<bool>(_state);
+  }
+
+ private:
+  bool is_live() const;
+  void flush() const;
+
+  UniquePtr<FpSimdState> _state;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_FP_SIMD_H_
@@ -0,0 +1,72 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// Futex.h - Fast user-space mutexes.
+//
+// A futex is a 32-bit word in user memory. User mode manipulates it with
+// atomic instructions alone, and only enters the kernel when it has to
+// sleep (FUTEX_WAIT) or to wake someone up (FUTEX_WAKE, FUTEX_REQUEUE).
+//
+// Waiters are keyed on the physical address of the word rather than on the
+// virtual one, so tasks in different address spaces which map the same page
+// frame (e.g., a parent and a child sharing a page after fork()) agree on
+// the futex. The keys are hashed into a fixed number of buckets, each with
+// its own lock and list of waiters.
+#ifndef VALKYRIE_FUTEX_H_
+#define VALKYRIE_FUTEX_H_
+
+#include <List.h>
+#include <Singleton.h>
+#include <SpinLock.h>
+#include <Types.h>
+
+#include <proc/WaitQueue.h>
+
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define FUTEX_REQUEUE 3
+
+#define NR_FUTEX_BUCKETS 64
+
+namespace valkyrie::kernel {
+
+class Futex : public Singleton<Futex> {
+ public:
+  // Puts the current task to sleep if `*uaddr` still equals `val`, until
+  // it's woken up by wake() or requeue(). Returns -1 if it doesn't.
+  int wait(int *uaddr, int val);
+
+  // Wakes up at most `nr_wake` tasks waiting on `uaddr`,
+  // and returns the number of tasks woken up.
+  int wake(int *uaddr, int nr_wake);
+
+  // Wakes up at most `nr_wake` tasks waiting on `uaddr`, and moves at most
+  // `nr_requeue` of the remaining ones over to `uaddr2`, so that they are
+  // woken up by a wake() on `uaddr2` instead. Returns the number of tasks
+  // woken up or moved.
+  int requeue(int *uaddr, int nr_wake, int *uaddr2, int nr_requeue);
+
+ protected:
+  Futex();
+
+ private:
+  // Lives on the kernel stack of the waiting task.
+  struct Waiter final {
+    size_t key;
+    bool woken;
+    WaitQueue wait_queue;
+  };
+
+  struct Bucket final {
+    SpinLock lock;
+    List<Waiter *> waiters;
+  };
+
+  Bucket &get_bucket(size_t key);
+  int wake_waiters(Bucket &bucket, size_t key, int nr_wake);
+
+  Bucket _buckets[NR_FUTEX_BUCKETS];
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_FUTEX_H_
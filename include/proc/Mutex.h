@@ -0,0 +1,42 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// Mutex.h - A sleepable mutual exclusion lock.
+//
+// Unlike a spinlock, a task which fails to acquire a Mutex is put to sleep
+// on a wait queue until the owner releases it, and the owner itself may
+// sleep or be preempted while holding it. IRQs stay enabled all along,
+// so it's meant for long operations such as filesystem and block I/O.
+// It must never be taken from IRQ context.
+#ifndef VALKYRIE_PROC_MUTEX_H_
+#define VALKYRIE_PROC_MUTEX_H_
+
+#include <TypeTraits.h>
+
+#include <proc/WaitQueue.h>
+
+namespace valkyrie::kernel {
+
+class Mutex {
+  MAKE_NONCOPYABLE(Mutex);
+  MAKE_NONMOVABLE(Mutex);
+
+ public:
+  Mutex();
+  ~Mutex() = default;
+
+  void lock();
+  void unlock();
+  bool try_lock();
+
+  bool is_locked() const {
+    return _owner;
+  }
+
+ private:
+  Task *_owner;
+  WaitQueue _wait_queue;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_PROC_MUTEX_H_
@@ -0,0 +1,64 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// PidMap.h - PID allocation and lookup.
+//
+// PIDs are handed out from a bitmap, starting right after the last one
+// allocated and wrapping around once PID_MAX is reached, so a PID isn't
+// reused until long after its task is gone, and the PID space never runs
+// out as long as there are free PIDs left in it.
+//
+// A task is attached to the PID hash (for get_by_pid() in O(1)) and to the
+// list of all tasks (for iteration without walking the process tree) from
+// its construction until it exits. Its PID stays allocated until the task
+// object is destroyed, i.e., until its parent has reaped it.
+#ifndef VALKYRIE_PID_MAP_H_
+#define VALKYRIE_PID_MAP_H_
+
+#include <Bitmap.h>
+#include <IntrusiveList.h>
+#include <Singleton.h>
+#include <SpinLock.h>
+#include <Types.h>
+
+#include <proc/Task.h>
+
+#define PID_MAX 32768
+#define PID_HASH_SIZE 128
+
+namespace valkyrie::kernel {
+
+class PidMap : public Singleton<PidMap> {
+ public:
+  // Returns -1 if all the PIDs are in use.
+  pid_t allocate();
+  void release(const pid_t pid);
+
+  void attach(Task &task);
+  void detach(Task &task);
+
+  // Returns nullptr if no attached task has `pid`.
+  Task *find(const pid_t pid);
+
+  template <typename UnaryFunction>
+  void for_each_task(UnaryFunction f) {
+    const LockGuard<SpinLock> lock(_lock);
+    _all_tasks.for_each(f);
+  }
+
+ protected:
+  PidMap();
+
+ private:
+  using PidHashList = IntrusiveList<Task, &Task::_pid_hash_node>;
+  using TaskList = IntrusiveList<Task, &Task::_all_tasks_node>;
+
+  SpinLock _lock;
+  Bitmap<PID_MAX> _bitmap;
+  pid_t _last_pid;
+  PidHashList _pid_hash[PID_HASH_SIZE];
+  TaskList _all_tasks;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_PID_MAP_H_
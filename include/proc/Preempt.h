@@ -0,0 +1,79 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// Preempt.h - Kernel preemption control.
+//
+// A task running in the kernel may be preempted when an IRQ returns, unless
+// its preempt count is non-zero. preempt_disable() and preempt_enable() nest,
+// and every spinlock and RCU read-side critical section holds a count, so a
+// task is never preempted while another task could be left spinning on it.
+//
+// The count lives in the CpuBlock of the core it's running on, and is saved
+// into the Task while it's switched out (see TaskScheduler), so each task
+// has one of its own.
+//
+// If a reschedule becomes pending while preemption is disabled, it's carried
+// out as soon as the count drops back to zero with IRQs enabled, rather than
+// at the next tick or the next return to user mode.
+//
+// Long loops in the kernel call cond_resched() between iterations as an
+// explicit preemption point, in case a reschedule is still pending (e.g.,
+// one requested while IRQs were disabled by code that doesn't check for it).
+#ifndef VALKYRIE_PREEMPT_H_
+#define VALKYRIE_PREEMPT_H_
+
+#include <kernel/Exception.h>
+#include <kernel/PerCpu.h>
+
+namespace valkyrie::kernel {
+
+// Switches to the next task. Defined in proc/TaskScheduler.cc.
+void preempt_schedule();
+
+[[gnu::always_inline]] inline int preempt_count() {
+  return this_cpu_block().preempt_count;
+}
+
+[[gnu::always_inline]] inline void set_need_resched() {
+  this_cpu_block().need_resched = true;
+}
+
+[[gnu::always_inline]] inline bool need_resched() {
+  return this_cpu_block().need_resched;
+}
+
+// Whether the current task can be switched out right here.
+[[gnu::always_inline]] inline bool preemptible() {
+  return !preempt_count() && !exception::are_irqs_disabled();
+}
+
+[[gnu::always_inline]] inline void preempt_disable() {
+  this_cpu_block().preempt_count++;
+  asm volatile("" ::: "memory");
+}
+
+// Drops the count without rescheduling. Only for paths which are
+// about to reschedule anyway, or which will call preempt_check_resched().
+[[gnu::always_inline]] inline void preempt_enable_no_resched() {
+  asm volatile("" ::: "memory");
+  this_cpu_block().preempt_count--;
+}
+
+// Carries out the pending reschedule, if any, as long as it's safe.
+[[gnu::always_inline]] inline void preempt_check_resched() {
+  if (need_resched() && preemptible()) [[unlikely]] {
+    preempt_schedule();
+  }
+}
+
+[[gnu::always_inline]] inline void preempt_enable() {
+  preempt_enable_no_resched();
+  preempt_check_resched();
+}
+
+[[gnu::always_inline]] inline void cond_resched() {
+  preempt_check_resched();
+}
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_PREEMPT_H_
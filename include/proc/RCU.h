@@ -0,0 +1,86 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// RCU.h - Read-Copy-Update for read-mostly data.
+//
+// Readers access an RCU-protected structure through an RCUPointer within
+// a read-side critical section (see RCUReadGuard), without taking any lock
+// or performing any atomic read-modify-write. A writer never modifies the
+// structure in place. Instead, it publishes a modified copy with
+// RCUPointer::publish(), waits for a grace period with RCU::synchronize(),
+// and only then frees the old version, because no reader can still be
+// looking at it by then. Writers must be serialized by the caller.
+//
+// A read-side critical section must not sleep, and it disables preemption,
+// so a core that has gone through a context switch (or is idle) is known to
+// have left all the critical sections it was in. A grace period is over
+// once every core has done so.
+#ifndef VALKYRIE_RCU_H_
+#define VALKYRIE_RCU_H_
+
+#include <Atomic.h>
+#include <Singleton.h>
+#include <TypeTraits.h>
+
+#include <kernel/PerCpu.h>
+#include <proc/Preempt.h>
+
+namespace valkyrie::kernel {
+
+class RCUReadGuard {
+  MAKE_NONCOPYABLE(RCUReadGuard);
+  MAKE_NONMOVABLE(RCUReadGuard);
+
+ public:
+  RCUReadGuard() {
+    preempt_disable();
+  }
+
+  ~RCUReadGuard() {
+    preempt_enable();
+  }
+};
+
+template <typename T>
+class RCUPointer {
+  MAKE_NONCOPYABLE(RCUPointer);
+  MAKE_NONMOVABLE(RCUPointer);
+
+ public:
+  explicit RCUPointer(T *p = nullptr) : _p(p) {}
+  ~RCUPointer() = default;
+
+  // The returned object may only be accessed within the
+  // read-side critical section in which read() was called.
+  T *read() const {
+    return _p.load(MemoryOrder::ACQUIRE);
+  }
+
+  // Makes `p` visible to the readers once it has been fully initialized,
+  // and returns the old version, which may only be freed after a grace period.
+  [[nodiscard]] T *publish(T *p) {
+    return _p.exchange(p, MemoryOrder::RELEASE);
+  }
+
+ private:
+  Atomic<T *> _p;
+};
+
+class RCU : public Singleton<RCU> {
+ public:
+  // Waits until all the read-side critical sections that have
+  // started before this call have ended. May yield the CPU.
+  void synchronize();
+
+  // Called by the scheduler on each context switch, and by the idle task.
+  void note_quiescent_state();
+
+ protected:
+  RCU();
+
+ private:
+  DEFINE_PER_CPU(Atomic<uint64_t>, _nr_quiescent_states);
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_RCU_H_
@@ -0,0 +1,45 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// RWSemaphore.h - A sleepable readers-writer lock.
+//
+// Any number of readers may hold it at once, or a single writer. Tasks
+// that can't get in are put to sleep instead of spinning. A waiting
+// writer blocks new readers, so writers are never starved.
+// It must never be taken from IRQ context.
+#ifndef VALKYRIE_PROC_RW_SEMAPHORE_H_
+#define VALKYRIE_PROC_RW_SEMAPHORE_H_
+
+#include <TypeTraits.h>
+#include <Types.h>
+
+#include <proc/WaitQueue.h>
+
+namespace valkyrie::kernel {
+
+class RWSemaphore {
+  MAKE_NONCOPYABLE(RWSemaphore);
+  MAKE_NONMOVABLE(RWSemaphore);
+
+ public:
+  RWSemaphore();
+  ~RWSemaphore() = default;
+
+  // Exclusive (writer) side.
+  void lock();
+  void unlock();
+
+  // Shared (reader) side.
+  void lock_shared();
+  void unlock_shared();
+
+ private:
+  Task *_writer;
+  size_t _nr_readers;
+  size_t _nr_waiting_writers;
+  WaitQueue _readers_wait_queue;
+  WaitQueue _writers_wait_queue;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_PROC_RW_SEMAPHORE_H_
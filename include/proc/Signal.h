@@ -27,6 +27,12 @@ enum Signal {
 using SignalHandler = void (*)(int);
 extern SignalHandler __default_signal_handler_table[Signal::__NR_signals];
 
+// The custom signal handlers of a process, which are
+// shared by the tasks cloned with CLONE_SIGHAND.
+struct SignalHandlerTable final {
+  SignalHandler handlers[Signal::__NR_signals];
+};
+
 [[gnu::always_inline]] inline bool is_signal_valid(const int signal) {
   return signal >= 0 && signal < Signal::__NR_signals;
 }
@@ -3,6 +3,7 @@
 #define VALKYRIE_TASK_H_
 
 #include <Concepts.h>
+#include <IntrusiveList.h>
 #include <List.h>
 #include <Memory.h>
 #include <Mutex.h>
@@ -13,14 +14,26 @@
 #include <fs/ELF.h>
 #include <fs/File.h>
 #include <fs/Vnode.h>
+#include <kernel/PerCpu.h>
 #include <mm/Page.h>
 #include <mm/UserspaceAccess.h>
 #include <mm/VirtualMemoryMap.h>
+#include <proc/FdTable.h>
+#include <proc/FpSimd.h>
 #include <proc/Signal.h>
+#include <proc/WaitQueue.h>
 
 #define TASK_TIME_SLICE 64
 #define TASK_NAME_MAX_LEN 16
-#define NR_TASK_FD_LIMITS 16
+
+// Scheduling policies
+#define SCHED_NORMAL 0 /* Time-sharing round-robin. */
+#define SCHED_FIFO 1   /* Real-time, runs until it blocks or yields. */
+#define SCHED_RR 2     /* Real-time, round-robin among equal priorities. */
+
+// Real-time priorities range from 1 (lowest) to MAX_RT_PRIO - 1 (highest).
+// SCHED_NORMAL tasks always have an rt priority of 0.
+#define MAX_RT_PRIO 100
 
 // mmap() prots
 #define PROT_NONE 0x0  /* Page can not be accessed. */
@@ -38,11 +51,18 @@
 #define MAP_ANONYMOUS 0x20   /* Don't use a file. */
 #define MAP_POPULATE 0x08000 /* Populate (prefault) pagetables. */
 
+// clone() flags
+#define CLONE_VM 0x00000100      /* Share the address space. */
+#define CLONE_FILES 0x00000400   /* Share the fd table. */
+#define CLONE_SIGHAND 0x00000800 /* Share the signal handlers (requires CLONE_VM). */
+#define CLONE_SETTLS 0x00080000  /* Set the TLS pointer (TPIDR_EL0). */
+
 namespace valkyrie::kernel {
 
 // Forward declaration.
 class Task;
 class TrapFrame;
+[[noreturn]] void start_kthreadd();
 
 extern "C" void switch_to(Task *prev, Task *next);
 extern "C" void switch_to_user_mode(void *entry_point, size_t user_sp, size_t kernel_sp,
@@ -55,6 +75,8 @@ class Task {
 
   // Friend declaration
   friend class TaskScheduler;
+  friend class PidMap;
+  friend void start_kthreadd();
 
  public:
   enum class State { CREATED, RUNNING, SLEEPING, TERMINATED, SIZE };
@@ -66,9 +88,7 @@ class Task {
   ~Task();
 
   [[gnu::always_inline]] inline static Task *current() {
-    Task *ret;
-    asm volatile("mrs %0, TPIDR_EL1" : "=r"(ret));
-    return ret;
+    return this_cpu_block().current_task;
   }
 
   [[gnu::always_inline]] inline void save_context() {
@@ -79,8 +99,17 @@ class Task {
   static Task *get_by_pid(const pid_t pid);
 
   int fork();
+
+  // Creates a child task which shares the resources specified by `flags` with
+  // this task, and copies the rest. If `stack` isn't null, the child returns
+  // to the user mode with it as its SP. See clone(2).
+  int clone(unsigned long flags, void __user *stack, void __user *tls);
+
   int exec(const char *name, const char *const _argv[]);
-  int wait(int *wstatus);
+
+  // Waits for the child `pid` to terminate, or any child if `pid` is -1.
+  int wait(pid_t pid, int *wstatus);
+  int nanosleep(const uint64_t ns);
   [[noreturn]] void exit(int error_code);
   long kill(pid_t pid, Signal signal);
   int signal(int signal, void (*handler)(int));
@@ -97,6 +126,7 @@ class Task {
   void execute_custom_signal_handler(const Signal signal);
 
   int allocate_fd_for_file(SharedPtr<File> file);
+  int install_file_at_fd(const int fd, SharedPtr<File> file);
   SharedPtr<File> release_fd_and_get_file(const int fd);
   SharedPtr<File> get_file_by_fd(const int fd) const;
   bool is_fd_valid(const int fd) const;
@@ -113,6 +143,10 @@ class Task {
     return _pid;
   }
 
+  Task *get_parent() const {
+    return _parent;
+  }
+
   TrapFrame *get_trap_frame() const {
     return _trap_frame;
   }
@@ -143,6 +177,18 @@ class Task {
     }
   }
 
+  int get_policy() const {
+    return _policy;
+  }
+
+  int get_rt_priority() const {
+    return _rt_priority;
+  }
+
+  bool is_rt_task() const {
+    return _policy == SCHED_FIFO || _policy == SCHED_RR;
+  }
+
   size_t get_children_count() const {
     return _active_children.size() + _terminated_children.size();
   }
@@ -164,18 +210,22 @@ class Task {
   }
 
   const VMMap &get_vmmap() const {
-    return _vmmap;
+    return *_vmmap;
+  }
+
+  FpSimdContext &get_fpsimd_context() {
+    return _fpsimd_context;
   }
 
   size_t *get_ttbr0_el1() const {
-    return _vmmap.get_pgd();
+    return _vmmap->get_pgd();
   }
 
   // Converts the virtual address to physical address by looking up the page table.
   template <Pointer T>
   T v2p(T v_addr) {
     auto addr = reinterpret_cast<size_t>(v_addr);
-    return reinterpret_cast<T>(_vmmap.get_physical_address(addr));
+    return reinterpret_cast<T>(_vmmap->get_physical_address(addr));
   }
 
  private:
@@ -191,9 +241,6 @@ class Task {
   static inline Task *_init = nullptr;
   static inline Task *_kthreadd = nullptr;
 
-  // PID starts at 0 (idle task).
-  static inline pid_t _next_pid = 0;
-
   // For now we keep this as the first member of Task, so that
   // proc/ctx_switch.S can access process context directly.
   struct Context {
@@ -210,29 +257,39 @@ class Task {
     uint64_t fp;
     uint64_t lr;
     uint64_t sp;
+    uint64_t tpidr_el0;  // the user TLS pointer
   } _context;
 
   bool _is_user_task;
   Task *_parent;
   List<Task *> _active_children;
   List<UniquePtr<Task>> _terminated_children;
+  WaitQueue _child_exit_wait_queue;
   Task::State _state;
   int _error_code;
   pid_t _pid;
+  IntrusiveListNode _pid_hash_node;   // see include/proc/PidMap.h
+  IntrusiveListNode _all_tasks_node;  // ditto
   int _time_slice;
-  VMMap _vmmap;
+  int _preempt_count;  // saved here while switched out, see include/proc/Preempt.h
+  RecursiveMutex::HolderState _bkl_state;  // ditto, see include/lib/Mutex.h
+  int _policy;
+  int _rt_priority;
+  uint64_t _wakeup_timestamp;  // CNTPCT_EL0 when last made runnable
+  SharedPtr<VMMap> _vmmap;  // shared by the tasks cloned with CLONE_VM
   void (*_entry_point)();
   Page _kstack_page;
   Page _ustack_page;
   TrapFrame *_trap_frame;
+  FpSimdContext _fpsimd_context;
   char _name[TASK_NAME_MAX_LEN];
 
   // POSIX signals
   List<Signal> _pending_signals;
-  SignalHandler _custom_signal_handlers[Signal::__NR_signals];
+  SharedPtr<SignalHandlerTable> _custom_signal_handlers;
 
   // Per-process file descriptors
-  SharedPtr<File> _fd_table[NR_TASK_FD_LIMITS];
+  SharedPtr<FdTable> _fd_table;
 
   // Current working directory
   SharedPtr<Vnode> _cwd_vnode;
@@ -2,33 +2,115 @@
 #ifndef VALKYRIE_TASK_SCHEDULER_H_
 #define VALKYRIE_TASK_SCHEDULER_H_
 
+#include <Atomic.h>
+#include <Bitmap.h>
 #include <List.h>
 #include <Memory.h>
 #include <Mutex.h>
 #include <Singleton.h>
+#include <SpinLock.h>
 
 #include <proc/Task.h>
 
 namespace valkyrie::kernel {
 
+// See sched_setscheduler(2).
+struct SchedParam final {
+  int sched_priority;
+};
+
 class TaskScheduler : public Singleton<TaskScheduler> {
+  friend void preempt_schedule();
+
  public:
   // Starts the task scheduler.
   void run();
 
+  // The idle task isn't kept in any runqueue.
+  // It only runs when there are no other runnable tasks.
+  void set_idle_task(UniquePtr<Task> task);
+
   void enqueue_task(UniquePtr<Task> task);
   UniquePtr<Task> remove_task(const Task &task);
 
+  // Changes the scheduling policy and rt priority of `task`.
+  int set_scheduler(Task &task, int policy, int rt_priority);
+
   void schedule();
   void maybe_schedule();
   void tick();
 
+  // Stops the periodic tick if the current task has no one to share the CPU
+  // with, or restarts it otherwise. See TimerMultiplexer::reprogram().
+  void update_tick();
+
+  // Real-time wakeup latency, i.e., the time between an rt task being
+  // made runnable and it actually getting the CPU.
+  size_t get_nr_rt_wakeups() const;
+  size_t get_last_rt_wakeup_latency_ns() const;
+  size_t get_max_rt_wakeup_latency_ns() const;
+
+  // Idle residency, i.e., how long (and how many times) the CPU
+  // has been halted in the idle task since the scheduler started.
+  size_t get_uptime_ns() const;
+  size_t get_idle_time_ns() const;
+  size_t get_nr_idle_entries() const;
+
+  // How many times a pending reschedule has been carried out at an explicit
+  // preemption point, e.g., at the end of a Kernel::mutex section.
+  size_t get_nr_kernel_preemptions() const;
+
  protected:
   TaskScheduler();
 
  private:
-  bool _need_reschedule;
+  // The same as enqueue_task() and remove_task(), but `_runqueue_lock`
+  // must have been acquired by the caller.
+  void do_enqueue_task(UniquePtr<Task> task);
+  UniquePtr<Task> do_remove_task(const Task &task);
+
+  List<UniquePtr<Task>> &get_runqueue(const Task &task);
+
+  // Returns the head of the highest-priority non-empty runqueue,
+  // or the idle task if all runqueues are empty.
+  Task *pick_next_task();
+
+  // Moves `task` from the head to the tail of its runqueue.
+  void requeue_task(const Task &task);
+
+  // Switches from the current task to the one returned by pick_next_task().
+  // The caller must hold `_runqueue_lock` with IRQs disabled, and this
+  // releases the lock right before the switch.
+  void switch_to_next_task();
+
+  bool should_preempt_current(const Task &task) const;
+  bool is_tick_needed(const Task &task);
+  void account_idle_time(const Task *prev, const Task *next);
+  void account_rt_wakeup_latency(Task &task);
+
+  // Protects all the runqueues. It's taken from IRQ context when a task
+  // is woken up, so it must be held with IRQs disabled.
+  SpinLock _runqueue_lock;
+  UniquePtr<Task> _idle_task;
+
+  // SCHED_NORMAL tasks share a single round-robin runqueue, while
+  // SCHED_FIFO/SCHED_RR tasks are queued by their rt priority.
+  // Bit i of `_rt_bitmap` is set iff `_rt_runqueues[i]` is non-empty.
   List<UniquePtr<Task>> _runqueue;
+  List<UniquePtr<Task>> _rt_runqueues[MAX_RT_PRIO];
+  Bitmap<MAX_RT_PRIO> _rt_bitmap;
+
+  // The statistics counters are read by /proc without `_runqueue_lock`.
+  Atomic<size_t> _nr_rt_wakeups;
+  uint64_t _last_rt_wakeup_latency;  // in CNTPCT_EL0 ticks
+  uint64_t _max_rt_wakeup_latency;   // in CNTPCT_EL0 ticks
+
+  uint64_t _start_timestamp;       // CNTPCT_EL0 when the scheduler started
+  uint64_t _idle_enter_timestamp;  // CNTPCT_EL0 when the idle task was switched in
+  Atomic<uint64_t> _idle_time;     // in CNTPCT_EL0 ticks
+  Atomic<size_t> _nr_idle_entries;
+
+  Atomic<size_t> _nr_kernel_preemptions;
 };
 
 }  // namespace valkyrie::kernel
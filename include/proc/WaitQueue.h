@@ -0,0 +1,56 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// WaitQueue.h - A queue of tasks sleeping until some condition becomes true.
+//
+// A sleeping task is taken off the runqueue entirely and the wait queue
+// owns it until wake_up() hands it back to the task scheduler, so a task
+// blocked on I/O or on its children costs no CPU time at all.
+#ifndef VALKYRIE_WAIT_QUEUE_H_
+#define VALKYRIE_WAIT_QUEUE_H_
+
+#include <List.h>
+#include <Memory.h>
+#include <TypeTraits.h>
+
+namespace valkyrie::kernel {
+
+// Forward declaration.
+class Task;
+
+class WaitQueue {
+  MAKE_NONCOPYABLE(WaitQueue);
+  MAKE_NONMOVABLE(WaitQueue);
+
+ public:
+  WaitQueue();
+  ~WaitQueue();
+
+  // Puts the current task to sleep until `cond` returns true.
+  //
+  // The caller must hold Kernel::mutex, so that evaluating `cond` and
+  // going to sleep cannot race with a wake_up() issued by an IRQ handler.
+  template <typename Predicate>
+  void sleep_on(Predicate cond) {
+    while (!cond()) {
+      sleep();
+    }
+  }
+
+  // Puts the current task to sleep until someone wakes it up.
+  void sleep();
+
+  // Wakes up the task which has been sleeping the longest.
+  void wake_up();
+
+  // Wakes up all the tasks sleeping on this wait queue.
+  void wake_up_all();
+
+  bool empty() const;
+
+ private:
+  List<UniquePtr<Task>> _tasks;
+};
+
+}  // namespace valkyrie::kernel
+
+#endif  // VALKYRIE_WAIT_QUEUE_H_
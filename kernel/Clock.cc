@@ -0,0 +1,73 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <kernel/Clock.h>
+
+#include <CString.h>
+#include <Mutex.h>
+
+#include <kernel/Kernel.h>
+#include <kernel/Timer.h>
+#include <mm/MemoryManager.h>
+
+#define CNTKCTL_EL1_EL0PCTEN (1 << 0) /* EL0 may read CNTPCT_EL0 and CNTFRQ_EL0 */
+
+namespace valkyrie::kernel {
+
+Clock::Clock() : _vdata(), _vdata_p_addr() {
+  // Let EL0 read the physical counter without trapping.
+  uint64_t cntkctl_el1;
+  asm volatile("mrs %0, cntkctl_el1" : "=r"(cntkctl_el1));
+  asm volatile("msr cntkctl_el1, %0" ::"r"(cntkctl_el1 | CNTKCTL_EL1_EL0PCTEN));
+
+  _vdata = reinterpret_cast<VDataPage *>(get_free_page());
+  _vdata_p_addr = reinterpret_cast<void *>(reinterpret_cast<size_t>(_vdata) - KERNEL_VA_BASE);
+  memset(_vdata, 0, PAGE_SIZE);
+
+  _vdata->cntfrq = ARMCoreTimer::get_frequency();
+
+  // The kernel holds a reference to the vdata page, so that it's never
+  // freed when a task unmaps it on exec() or exit().
+  MemoryManager::the().inc_page_ref_count(_vdata_p_addr);
+}
+
+uint64_t Clock::get_monotonic_ns() const {
+  return ARMCoreTimer::counter_to_ns(ARMCoreTimer::get_counter());
+}
+
+uint64_t Clock::get_realtime_ns() const {
+  return _vdata->realtime_offset_ns + get_monotonic_ns();
+}
+
+void Clock::set_realtime_ns(const uint64_t ns) {
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  _vdata->seq = _vdata->seq + 1;
+  asm volatile("dmb ishst" ::: "memory");
+  _vdata->realtime_offset_ns = ns - get_monotonic_ns();
+  asm volatile("dmb ishst" ::: "memory");
+  _vdata->seq = _vdata->seq + 1;
+}
+
+int Clock::get_time(const int clockid, TimeSpec &ts) const {
+  uint64_t ns;
+
+  switch (clockid) {
+    case CLOCK_REALTIME:
+      ns = get_realtime_ns();
+      break;
+    case CLOCK_MONOTONIC:
+      ns = get_monotonic_ns();
+      break;
+    default:
+      return -1;
+  }
+
+  ts.tv_sec = ns / NSEC_PER_SEC;
+  ts.tv_nsec = ns % NSEC_PER_SEC;
+  return 0;
+}
+
+void Clock::map_vdata_page(const VMMap &vmmap) const {
+  vmmap.map(USER_VDATA_PAGE, _vdata_p_addr, USER_PAGE_R);
+}
+
+}  // namespace valkyrie::kernel
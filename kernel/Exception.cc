@@ -2,6 +2,7 @@
 #include <kernel/Exception.h>
 
 #include <dev/Console.h>
+#include <driver/MiniUART.h>
 #include <kernel/Kernel.h>
 #include <kernel/Syscall.h>
 #include <kernel/TimerMultiplexer.h>
@@ -67,7 +68,8 @@ void handle_syscall(TrapFrame *trap_frame) {
   // Handle pending POSIX signals.
   Task::current()->handle_pending_signals();
 
-  // If the current task has used up its time slice, preempt it with the next one.
+  // If the current task has used up its time slice or a higher-priority
+  // task has become runnable, preempt it with the next one.
   TaskScheduler::the().maybe_schedule();
 
   if (Task::current()->is_user_task()) {
@@ -92,6 +94,17 @@ void handle_page_fault() {
   switch_user_va_space(Task::current()->get_ttbr0_el1());
 }
 
+void handle_fpsimd_access() {
+  auto task = Task::current();
+
+  // Without a save area, returning would only retry the same instruction
+  // and trap again, so the task has to die right here.
+  if (!task->get_fpsimd_context().load()) [[unlikely]] {
+    task->kill(task->get_pid(), Signal::SIGKILL);
+    task->handle_pending_signals();
+  }
+}
+
 void unhandled_exception(const Exception &ex) {
   printk("Current exception lvl: %d\n", ex.level);
   printk("Saved Program Status Register: 0x%p\n", ex.spsr_el1);
@@ -101,6 +114,8 @@ void unhandled_exception(const Exception &ex) {
 
   // For ec and iss, see ARMv8 manual p.1877
   switch (ex.ec) {
+    case 0b000111:
+      Kernel::panic("Trapped access to SIMD/FP functionality in the kernel\n");
     case 0b011000:
       Kernel::panic("Trapped MSR, MRS, or System instruction execution\n");
     case 0b011001:
@@ -126,21 +141,38 @@ void handle_exception(TrapFrame *trap_frame) {
     handle_syscall(trap_frame);
   } else if (ex.ec == 0b100100) {
     handle_page_fault();
+  } else if (ex.ec == 0b000111 && ex.ret_addr < KERNEL_VA_BASE) {
+    // The kernel never uses FP/SIMD, so only user code may get here.
+    handle_fpsimd_access();
   } else {
     unhandled_exception(ex);
   }
 }
 
 void handle_irq(TrapFrame *trap_frame) {
-  // XXX: For now we have tiemr IRQ as the only interrupt source.
   const Exception ex = get_current_exception();
 
   switch_user_va_space(nullptr);
 
-  TimerMultiplexer::the().tick();
-  TaskScheduler::the().tick();
+  const uint32_t irq_source = io::get<uint32_t>(CORE0_IRQ_SOURCE);
+
+  if ((irq_source & CORE0_IRQ_SOURCE_GPU) &&
+      (io::get<uint32_t>(IRQ_PENDING_1) & MINI_UART_IRQ)) {
+    MiniUART::the().handle_irq();
+  }
+
+  if (irq_source & CORE0_IRQ_SOURCE_CNTPNSIRQ) {
+    TimerMultiplexer::the().tick();
+    TaskScheduler::the().tick();
+  }
+
+  // The IRQ handlers above may have woken up a higher-priority task.
   TaskScheduler::the().maybe_schedule();
 
+  // Rearm the core timer for whatever expires next. Without this, an expired
+  // CNTP_CVAL_EL0 would keep the timer IRQ asserted.
+  TaskScheduler::the().update_tick();
+
   // Handle pending POSIX signals.
   Task::current()->handle_pending_signals();
 
@@ -9,6 +9,7 @@ Kernel::Kernel()
       _console(Console::the()),
       _timer_multiplexer(TimerMultiplexer::the()),
       _memory_manager(MemoryManager::the()),
+      _clock(Clock::the()),
       _task_scheduler(TaskScheduler::the()),
       _vfs(VFS::the()) {}
 
@@ -26,9 +27,10 @@ void Kernel::run() {
   _vfs.populate_devtmpfs();
 
   printk("Creating initial tasks\n");
-  _task_scheduler.enqueue_task(make_kernel_task(nullptr, idle, "idle"));
+  _task_scheduler.set_idle_task(make_kernel_task(nullptr, idle, "idle"));
   _task_scheduler.enqueue_task(make_user_task(nullptr, start_init, "start_init"));
   _task_scheduler.enqueue_task(make_kernel_task(nullptr, start_kthreadd, "start_kthreadd"));
+  _task_scheduler.enqueue_task(make_kernel_task(nullptr, start_kreadaheadd, "kreadaheadd"));
 
   printk("Enabling timer interrupts\n");
   _timer_multiplexer.get_arm_core_timer().enable();
@@ -1,9 +1,15 @@
 // Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include <kernel/Syscall.h>
 
+#include <Algorithm.h>
+#include <Mutex.h>
+
 #include <dev/Console.h>
 #include <fs/VirtualFileSystem.h>
+#include <kernel/Clock.h>
+#include <kernel/Kernel.h>
 #include <kernel/TimerMultiplexer.h>
+#include <proc/Futex.h>
 #include <proc/Task.h>
 #include <proc/TaskScheduler.h>
 
@@ -37,17 +43,20 @@ const size_t __syscall_table[Syscall::__NR_syscall] = {
     SYSCALL_DECL(sys_mmap),
     SYSCALL_DECL(sys_munmap),
     SYSCALL_DECL(sys_sigreturn),
+    SYSCALL_DECL(sys_sched_setscheduler),
+    SYSCALL_DECL(sys_clock_gettime),
+    SYSCALL_DECL(sys_nanosleep),
+    SYSCALL_DECL(sys_clone),
+    SYSCALL_DECL(sys_waitpid),
+    SYSCALL_DECL(sys_futex),
+    SYSCALL_DECL(sys_dup),
+    SYSCALL_DECL(sys_dup2),
 };
 // clang-format on
 
 int sys_read(int fd, void __user *buf, size_t count) {
   buf = Task::current()->v2p(buf);
 
-  // TODO: define stdin...
-  if (fd == 0) {
-    return Console::the().read(reinterpret_cast<char *>(buf), count);
-  }
-
   SharedPtr<File> file = Task::current()->get_file_by_fd(fd);
 
   if (!file) {
@@ -55,17 +64,19 @@ int sys_read(int fd, void __user *buf, size_t count) {
     return -1;
   }
 
+  // TODO: define stdin...
+  // For now, the file that fd 0,1,2 initially refer to has no vnode,
+  // and it stands for the console wherever it's dup()'ed to.
+  if (!file->vnode) {
+    return Console::the().read(reinterpret_cast<char *>(buf), count);
+  }
+
   return VFS::the().read(file, buf, count);
 }
 
 int sys_write(int fd, const void __user *buf, size_t count) {
   buf = Task::current()->v2p(buf);
 
-  // TODO: define stdout and stderr...
-  if (fd == 1 || fd == 2) {
-    return Console::the().write(reinterpret_cast<const char *>(buf), count);
-  }
-
   SharedPtr<File> file = Task::current()->get_file_by_fd(fd);
 
   if (!file) {
@@ -73,6 +84,11 @@ int sys_write(int fd, const void __user *buf, size_t count) {
     return -1;
   }
 
+  // TODO: define stdout and stderr...
+  if (!file->vnode) {
+    return Console::the().write(reinterpret_cast<const char *>(buf), count);
+  }
+
   return VFS::the().write(file, buf, count);
 }
 
@@ -104,6 +120,31 @@ int sys_close(int fd) {
   return VFS::the().close(file);
 }
 
+int sys_dup(int oldfd) {
+  SharedPtr<File> file = Task::current()->get_file_by_fd(oldfd);
+
+  if (!file) [[unlikely]] {
+    return -1;
+  }
+
+  return Task::current()->allocate_fd_for_file(move(file));
+}
+
+int sys_dup2(int oldfd, int newfd) {
+  SharedPtr<File> file = Task::current()->get_file_by_fd(oldfd);
+
+  if (!file) [[unlikely]] {
+    return -1;
+  }
+
+  // Closing `newfd` would close `oldfd` as well.
+  if (oldfd == newfd) {
+    return newfd;
+  }
+
+  return Task::current()->install_file_at_fd(newfd, move(file));
+}
+
 int sys_fork() {
   return Task::current()->fork();
 }
@@ -116,7 +157,7 @@ int sys_exec(const char __user *name, const char __user *argv[]) {
 
 int sys_wait(int __user *wstatus) {
   wstatus = Task::current()->v2p(wstatus);
-  return Task::current()->wait(wstatus);
+  return Task::current()->wait(-1, wstatus);
 }
 
 [[noreturn]] void sys_exit(int error_code) {
@@ -216,4 +257,127 @@ int sys_sigreturn() {
   return -1;
 }
 
+int sys_sched_setscheduler(pid_t pid, int policy, const SchedParam __user *param) {
+  param = Task::current()->v2p(param);
+
+  if (!param) [[unlikely]] {
+    return -1;
+  }
+
+  // Held so that `task` can't exit under us.
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  // A pid of zero refers to the calling task.
+  Task *current = Task::current();
+  Task *task = (pid == 0) ? current : Task::get_by_pid(pid);
+
+  if (!task) [[unlikely]] {
+    return -1;
+  }
+
+  // There are no users yet, so a task may only change the policy of itself
+  // and of its children, unless it's privileged, i.e., init or a kernel thread.
+  const bool is_privileged = current->get_pid() == 1 || !current->is_user_task();
+
+  if (task != current && task->get_parent() != current && !is_privileged) [[unlikely]] {
+    printk("sched_setscheduler: pid %d may not change pid %d\n", current->get_pid(),
+           task->get_pid());
+    return -1;
+  }
+
+  return TaskScheduler::the().set_scheduler(*task, policy, param->sched_priority);
+}
+
+int sys_clock_gettime(int clockid, TimeSpec __user *tp) {
+  tp = Task::current()->v2p(tp);
+
+  if (!tp) [[unlikely]] {
+    return -1;
+  }
+
+  return Clock::the().get_time(clockid, *tp);
+}
+
+int sys_nanosleep(const TimeSpec __user *req, TimeSpec __user *rem) {
+  req = Task::current()->v2p(req);
+
+  // time_t is unsigned here, but a negative tv_sec from the user is still invalid.
+  if (!req || static_cast<int64_t>(req->tv_sec) < 0 || req->tv_nsec < 0 ||
+      req->tv_nsec >= NSEC_PER_SEC) [[unlikely]] {
+    return -1;
+  }
+
+  // `rem` is optional, but a bad one is rejected before we go to sleep.
+  if (rem && !(rem = Task::current()->v2p(rem))) [[unlikely]] {
+    return -1;
+  }
+
+  // A sleep too long to be counted in nanoseconds (some 584 years)
+  // is clamped to the longest one that can.
+  constexpr uint64_t max_tv_sec = static_cast<uint64_t>(-1) / NSEC_PER_SEC - 1;
+  const uint64_t tv_sec = min(static_cast<uint64_t>(req->tv_sec), max_tv_sec);
+
+  int ret = Task::current()->nanosleep(tv_sec * NSEC_PER_SEC + req->tv_nsec);
+
+  // Sleeps are never interrupted, so there's no remaining time.
+  if (rem) {
+    rem->tv_sec = 0;
+    rem->tv_nsec = 0;
+  }
+
+  return ret;
+}
+
+int sys_clone(unsigned long flags, void __user *stack, void __user *tls) {
+  // Both `stack` and `tls` are handed back to the user mode as they are.
+  return Task::current()->clone(flags, stack, tls);
+}
+
+int sys_waitpid(pid_t pid, int __user *wstatus, int options) {
+  // No options are supported yet.
+  if (options) [[unlikely]] {
+    return -1;
+  }
+
+  wstatus = Task::current()->v2p(wstatus);
+  return Task::current()->wait(pid, wstatus);
+}
+
+int sys_futex(int __user *uaddr, int op, int val, int __user *uaddr2, int val2) {
+  // A futex word must be naturally aligned, so that it never straddles two pages.
+  if (reinterpret_cast<size_t>(uaddr) & (sizeof(int) - 1)) [[unlikely]] {
+    return -1;
+  }
+
+  uaddr = Task::current()->v2p(uaddr);
+
+  if (!uaddr) [[unlikely]] {
+    return -1;
+  }
+
+  switch (op) {
+    case FUTEX_WAIT:
+      return Futex::the().wait(uaddr, val);
+
+    case FUTEX_WAKE:
+      return Futex::the().wake(uaddr, val);
+
+    case FUTEX_REQUEUE:
+      if (reinterpret_cast<size_t>(uaddr2) & (sizeof(int) - 1)) [[unlikely]] {
+        return -1;
+      }
+
+      uaddr2 = Task::current()->v2p(uaddr2);
+
+      if (!uaddr2) [[unlikely]] {
+        return -1;
+      }
+
+      return Futex::the().requeue(uaddr, val, uaddr2, val2);
+
+    default:
+      return -1;
+  }
+}
+
 }  // namespace valkyrie::kernel
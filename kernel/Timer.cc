@@ -13,6 +13,11 @@
 // delta timer value to CNTP_TVAL_EL0, in that case CNTP_CVAL_EL0
 // will be automatically populated with new value = CNTP_TVAL_EL0 + CNTPCT_EL0.
 //
+// The timer isn't rearmed at a fixed interval. Instead, the timer multiplexer
+// writes the absolute deadline of the next event (or the next periodic tick,
+// if the scheduler needs one) to CNTP_CVAL_EL0, so an idle core is not woken
+// up by ticks it doesn't need.
+//
 // Reference:
 // [1] https://grasslab.github.io/NYCU_Operating_System_Capstone/labs/lab4.html
 // [2] https://lowenware.com/blog/osdev/aarch64-gic-and-timer-interrupt/
@@ -21,12 +26,18 @@
 #include <kernel/Timer.h>
 
 #define CORE0_TIMER_IRQ_CTRL 0x40000040
-#define DEFAULT_TIMER_IRQ_INTERVAL 1 /* in seconds */
+#define TIMER_HZ 1000 /* periodic ticks per second */
+
+#define CNTP_CTL_ENABLE (1 << 0)
+#define CNTP_CTL_IMASK (1 << 1)
 
 namespace valkyrie::kernel {
 
 ARMCoreTimer::ARMCoreTimer()
-    : _is_enabled(), _interval(DEFAULT_TIMER_IRQ_INTERVAL), _jiffies() {}
+    : _is_enabled(),
+      _interval(get_frequency() / TIMER_HZ),
+      _last_tick(),
+      _jiffies() {}
 
 bool ARMCoreTimer::is_enabled() const {
   return _is_enabled;
@@ -37,12 +48,12 @@ void ARMCoreTimer::enable() {
     return;
   }
 
-  // Enable ARM Core Timer.
-  asm volatile("msr CNTP_CTL_EL0, %0" ::"r"(1));
   // Unmask timer interrupt.
   asm volatile("str %0, [%1]" ::"r"(0b0010), "r"(CORE0_TIMER_IRQ_CTRL));
 
-  arrange_next_timer_irq_after(_interval);
+  // Enable ARM Core Timer.
+  _last_tick = get_counter();
+  arrange_next_timer_irq_at(_last_tick + _interval);
   _is_enabled = true;
 }
 
@@ -60,18 +71,30 @@ void ARMCoreTimer::disable() {
 }
 
 void ARMCoreTimer::tick() {
-  arrange_next_timer_irq_after(_interval);
-  ++_jiffies;
+  // While the periodic tick is stopped, several tick periods may have
+  // elapsed since the last one, so we catch up on jiffies here.
+  uint64_t nr_ticks = (get_counter() - _last_tick) / _interval;
+
+  _last_tick += nr_ticks * _interval;
+  _jiffies += nr_ticks;
+}
+
+void ARMCoreTimer::arrange_next_timer_irq_at(const uint64_t deadline) {
+  asm volatile("msr CNTP_CVAL_EL0, %0" ::"r"(deadline));
+  asm volatile("msr CNTP_CTL_EL0, %0" ::"r"(CNTP_CTL_ENABLE));
+}
+
+void ARMCoreTimer::cancel_next_timer_irq() {
+  asm volatile("msr CNTP_CTL_EL0, %0" ::"r"(CNTP_CTL_ENABLE | CNTP_CTL_IMASK));
 }
 
-void ARMCoreTimer::arrange_next_timer_irq_after(const uint32_t second) {
-  uint64_t cntfrq_el0;
-  asm volatile("mrs %0, CNTFRQ_EL0" : "=r"(cntfrq_el0));
-  // asm volatile("msr CNTP_TVAL_EL0, %0" :: "r"(cntfrq_el0 * second));
-  asm volatile("msr CNTP_TVAL_EL0, %0" ::"r"(0x0ffff));
+uint64_t ARMCoreTimer::get_next_tick() const {
+  // Keep the ticks aligned to `_last_tick`, even if the tick was stopped.
+  uint64_t now = get_counter();
+  return now + _interval - (now - _last_tick) % _interval;
 }
 
-uint32_t ARMCoreTimer::get_jiffies() const {
+uint64_t ARMCoreTimer::get_jiffies() const {
   return _jiffies;
 }
 
@@ -1,42 +1,116 @@
 // Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include <kernel/TimerMultiplexer.h>
 
-#include <dev/Console.h>
+#include <Algorithm.h>
+#include <SpinLock.h>
+
+#include <kernel/Kernel.h>
 #include <kernel/Timer.h>
 
 namespace valkyrie::kernel {
 
-TimerMultiplexer::TimerMultiplexer() : _arm_core_timer(), _events() {}
+TimerMultiplexer::TimerMultiplexer()
+    : _arm_core_timer(),
+      _timer_wheels(),
+      _timer_wheel_locks() {}
 
 void TimerMultiplexer::tick() {
   _arm_core_timer.tick();
 
-  // printk("ARM core timer interrupt: jiffies = %d\n",
-  //        _arm_core_timer.get_jiffies());
-
-  for (size_t i = 0; i < _events.size(); i++) {
-    auto &ev = _events[i];
+  TimerWheel::EventList expired;
+  TimerWheel &wheel = get_timer_wheel();
+  {
+    const IrqSaveLockGuard<SpinLock> lock(get_timer_wheel_lock(wheel));
+    wheel.collect_expired(ARMCoreTimer::get_counter(), expired);
+  }
 
-    if (ev.timeout-- == 0) {
-      ev.callback();
-      _events.erase(i--);
-    }
+  while (!expired.empty()) {
+    Event &event = expired.front();
+    expired.pop_front();
 
-    if (_events.empty()) {
-      _events.clear();
-      _arm_core_timer.disable();
-    }
+    // The callback may re-arm the event and assign it a new callback.
+    auto callback = event.callback;
+    callback();
   }
 }
 
-void TimerMultiplexer::add_timer(Event::Callback callback, const uint32_t timeout) {
-  printk("event registered. it will be triggered after %d secs\n", timeout);
-  _events.push_back(Event{move(callback), timeout});
+void TimerMultiplexer::add_timer(Event &event, const uint64_t timeout_ns,
+                                 const uint64_t slack_ns) {
+  add_timer_at(event, ARMCoreTimer::get_counter() + ARMCoreTimer::ns_to_counter(timeout_ns),
+               slack_ns);
+}
+
+void TimerMultiplexer::add_timer_at(Event &event, const uint64_t deadline,
+                                    const uint64_t slack_ns) {
+  // XXX: An event that is pending on another core's wheel should be
+  // cancelled under that wheel's lock. NR_CPUS is 1 for now.
+  TimerWheel &wheel = get_timer_wheel();
+  const IrqSaveLockGuard<SpinLock> lock(get_timer_wheel_lock(wheel));
+
+  if (event.is_pending()) {
+    do_cancel_timer(event);
+  }
+
+  event.deadline = deadline;
+  event.slack = ARMCoreTimer::ns_to_counter(slack_ns);
+  wheel.add(event);
   _arm_core_timer.enable();
 }
 
+void TimerMultiplexer::cancel_timer(Event &event) {
+  const TimerWheel &wheel = event._wheel ? *event._wheel : get_timer_wheel();
+  const IrqSaveLockGuard<SpinLock> lock(get_timer_wheel_lock(wheel));
+
+  do_cancel_timer(event);
+}
+
+void TimerMultiplexer::do_cancel_timer(Event &event) {
+  if (!event.is_pending()) {
+    return;
+  }
+
+  // An expired event which hasn't been run yet no longer belongs to any wheel.
+  if (!event._wheel) {
+    event._node.unlink();
+    return;
+  }
+
+  event._wheel->remove(event);
+}
+
+void TimerMultiplexer::reprogram(bool need_tick) {
+  TimerWheel &wheel = get_timer_wheel();
+  const IrqSaveLockGuard<SpinLock> lock(get_timer_wheel_lock(wheel));
+
+  uint64_t deadline = need_tick ? _arm_core_timer.get_next_tick() : TimerWheel::npos;
+  deadline = min(deadline, wheel.get_next_expiry());
+
+  // Nothing to wait for, so don't wake up the core at all.
+  if (deadline == TimerWheel::npos) {
+    _arm_core_timer.cancel_next_timer_irq();
+    return;
+  }
+
+  _arm_core_timer.arrange_next_timer_irq_at(deadline);
+}
+
 ARMCoreTimer &TimerMultiplexer::get_arm_core_timer() {
   return _arm_core_timer;
 }
 
+TimerWheel &TimerMultiplexer::get_timer_wheel() {
+  return this_cpu(_timer_wheels);
+}
+
+SpinLock &TimerMultiplexer::get_timer_wheel_lock(const TimerWheel &wheel) {
+  for (size_t cpu = 0; cpu < NR_CPUS; cpu++) {
+    if (&per_cpu(_timer_wheels, cpu) == &wheel) {
+      return per_cpu(_timer_wheel_locks, cpu);
+    }
+  }
+
+  Kernel::panic("TimerMultiplexer: unknown timer wheel 0x%p\n", &wheel);
+  return this_cpu(_timer_wheel_locks);
+}
+
 }  // namespace valkyrie::kernel
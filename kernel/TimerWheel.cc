@@ -0,0 +1,204 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <kernel/TimerWheel.h>
+
+#include <Algorithm.h>
+
+#include <kernel/Timer.h>
+#include <kernel/TimerMultiplexer.h>
+
+namespace valkyrie::kernel {
+
+TimerEvent::TimerEvent()
+    : callback(), deadline(), slack(), _wheel(), _level(), _slot(), _node() {}
+
+TimerEvent::TimerEvent(Callback callback)
+    : callback(move(callback)), deadline(), slack(), _wheel(), _level(), _slot(), _node() {}
+
+TimerEvent::~TimerEvent() {
+  if (is_pending()) {
+    TimerMultiplexer::the().cancel_timer(*this);
+  }
+}
+
+TimerWheel::TimerWheel() : _clk(), _nr_events(), _slots(), _pending() {}
+
+void TimerWheel::add(TimerEvent &event) {
+  // The wheel's clock only advances when the core timer fires, so it may lag
+  // far behind if the wheel has been empty for a while. Catch up first.
+  if (!_nr_events) {
+    _clk = max(_clk, to_granule(ARMCoreTimer::get_counter()));
+  }
+
+  insert(event);
+}
+
+void TimerWheel::remove(TimerEvent &event) {
+  event._node.unlink();
+
+  if (_slots[event._level][event._slot].empty()) {
+    _pending[event._level].clear(event._slot);
+  }
+
+  event._wheel = nullptr;
+  _nr_events--;
+}
+
+void TimerWheel::collect_expired(const uint64_t now, EventList &expired) {
+  const uint64_t target = to_granule(now);
+
+  while (true) {
+    // Skip the granules in which there's nothing to do.
+    if (_clk < target) {
+      _clk = min(find_next_pending_granule(), target);
+    }
+
+    process_granule(now, expired);
+
+    // The current granule may still hold events which expire later on,
+    // so we stay here until the next call.
+    if (_clk >= target) {
+      break;
+    }
+
+    _clk++;
+  }
+}
+
+uint64_t TimerWheel::get_next_expiry() const {
+  uint64_t expiry = npos;
+
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    const uint64_t slot = find_next_pending_slot(level);
+
+    if (slot == npos) {
+      continue;
+    }
+
+    // The events in the later slots of this level expire no earlier than
+    // the end of this slot, so slack mustn't delay the interrupt beyond it.
+    const int shift = level * TIMER_WHEEL_SLOT_BITS;
+    expiry = min(expiry, to_counter((slot + 1) << shift));
+
+    _slots[level][slot % TIMER_WHEEL_SLOTS].for_each([&expiry](const TimerEvent &event) {
+      expiry = min(expiry, event.deadline + event.slack);
+    });
+  }
+
+  return expiry;
+}
+
+void TimerWheel::insert(TimerEvent &event) {
+  uint64_t granule = max(to_granule(event.deadline), _clk);
+  const uint64_t delta = granule - _clk;
+
+  // Events beyond the range of the wheel are parked in the farthest slot
+  // of the top level, and will be re-hashed when it's cascaded.
+  constexpr uint64_t range = 1ULL << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS);
+
+  if (delta >= range) [[unlikely]] {
+    granule = _clk + range - 1;
+  }
+
+  int level = 0;
+  while (level < TIMER_WHEEL_LEVELS - 1 &&
+         delta >= 1ULL << ((level + 1) * TIMER_WHEEL_SLOT_BITS)) {
+    level++;
+  }
+
+  const size_t slot = (granule >> (level * TIMER_WHEEL_SLOT_BITS)) % TIMER_WHEEL_SLOTS;
+
+  event._wheel = this;
+  event._level = level;
+  event._slot = slot;
+  _slots[level][slot].push_back(event);
+  _pending[level].set(slot);
+  _nr_events++;
+}
+
+uint64_t TimerWheel::find_next_pending_slot(const int level) const {
+  const int shift = level * TIMER_WHEEL_SLOT_BITS;
+  uint64_t start = _clk >> shift;
+
+  // A slot of a higher level is processed when `_clk` enters it, so if `_clk`
+  // is already past the beginning of its slot, that slot has been processed.
+  if (_clk & ((1ULL << shift) - 1)) {
+    start++;
+  }
+
+  const size_t start_idx = start % TIMER_WHEEL_SLOTS;
+  size_t idx = _pending[level].find_next_set(start_idx);
+
+  // Wrap around.
+  if (idx == Bitmap<TIMER_WHEEL_SLOTS>::npos) {
+    idx = _pending[level].find_first_set();
+  }
+
+  if (idx == Bitmap<TIMER_WHEEL_SLOTS>::npos) {
+    return npos;
+  }
+
+  return start + ((idx - start_idx) % TIMER_WHEEL_SLOTS);
+}
+
+uint64_t TimerWheel::find_next_pending_granule() const {
+  uint64_t granule = npos;
+
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    const uint64_t slot = find_next_pending_slot(level);
+
+    if (slot != npos) {
+      granule = min(granule, slot << (level * TIMER_WHEEL_SLOT_BITS));
+    }
+  }
+
+  return granule;
+}
+
+void TimerWheel::process_granule(const uint64_t now, EventList &expired) {
+  // Cascade the higher levels first, since their events may end up
+  // in the lower levels' slots that are processed at this granule.
+  for (int level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+    const int shift = level * TIMER_WHEEL_SLOT_BITS;
+
+    if (!(_clk & ((1ULL << shift) - 1))) {
+      cascade(level, (_clk >> shift) % TIMER_WHEEL_SLOTS);
+    }
+  }
+
+  const size_t slot = _clk % TIMER_WHEEL_SLOTS;
+  EventList not_expired;
+
+  while (!_slots[0][slot].empty()) {
+    TimerEvent &event = _slots[0][slot].front();
+    _slots[0][slot].pop_front();
+
+    if (event.deadline <= now) {
+      event._wheel = nullptr;
+      _nr_events--;
+      expired.push_back(event);
+    } else {
+      not_expired.push_back(event);
+    }
+  }
+
+  _slots[0][slot].splice(not_expired);
+
+  if (_slots[0][slot].empty()) {
+    _pending[0].clear(slot);
+  }
+}
+
+void TimerWheel::cascade(const int level, const size_t slot) {
+  EventList events;
+  events.splice(_slots[level][slot]);
+  _pending[level].clear(slot);
+
+  while (!events.empty()) {
+    TimerEvent &event = events.front();
+    events.pop_front();
+    _nr_events--;
+    insert(event);
+  }
+}
+
+}  // namespace valkyrie::kernel
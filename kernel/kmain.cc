@@ -3,6 +3,8 @@
 
 #include <CString.h>
 
+#include <kernel/PerCpu.h>
+
 extern char _bss_start[0];
 extern char _bss_end[0];
 
@@ -14,6 +16,7 @@ using namespace valkyrie::kernel;
 
 extern "C" [[noreturn]] void kmain(void) {
   memset(_bss_start, 0, _bss_end - _bss_start);
+  init_cpu_block();
 
   for (ctor_func_t *ctor = &start_ctors; ctor != &end_ctors; ctor++) {
     (*ctor)();
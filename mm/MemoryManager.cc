@@ -13,29 +13,32 @@ MemoryManager::MemoryManager()
       _zones{Zone(0x10000000), Zone(0x10200000)},
       _ref_counts(),
       _page_writable(),
+      _kasan_lock(),
       _kasan() {}
 
 void *MemoryManager::get_free_page(bool physical) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  const IrqSaveLockGuard<SpinLock> lock(_zones[0].lock);
 
   void *ret = _zones[0].buddy_allocator.allocate_one_page_frame();
-  _kasan.mark_allocated(ret);
+  mark_allocated(ret);
 
   return physical ? ret
                   : reinterpret_cast<void *>(KERNEL_VA_BASE + reinterpret_cast<size_t>(ret));
 }
 
 void *MemoryManager::kmalloc(size_t size) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
   void *ret;
 
   if (size + SlobAllocator::get_chunk_header_size() >= PAGE_SIZE) {
+    const IrqSaveLockGuard<SpinLock> lock(_zones[0].lock);
     ret = _zones[0].buddy_allocator.allocate(size);
+    mark_allocated(ret);
   } else {
+    const IrqSaveLockGuard<SpinLock> lock(_zones[1].lock);
     ret = _zones[1].slob_allocator.allocate(size);
+    mark_allocated(ret);
   }
 
-  _kasan.mark_allocated(ret);
   return ret;
 }
 
@@ -47,38 +50,47 @@ void MemoryManager::kfree(void *p) {
   }
   p = reinterpret_cast<void *>(addr);
 
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-  _kasan.mark_free_chk(p);
-
   if (Page::is_aligned(p)) {
+    const IrqSaveLockGuard<SpinLock> lock(_zones[0].lock);
+    mark_free_chk(p);
     _zones[0].buddy_allocator.deallocate(p);
   } else {
+    const IrqSaveLockGuard<SpinLock> lock(_zones[1].lock);
+    mark_free_chk(p);
     _zones[1].slob_allocator.deallocate(p);
   }
 }
 
 String MemoryManager::get_buddy_info() const {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-  return _zones[0].buddy_allocator.to_string();
+  // to_string() allocates from the zones itself, so we can't hold their locks
+  // here. Keep IRQ handlers from modifying the allocator underneath us instead.
+  const size_t flags = exception::save_and_disable_irqs();
+  String ret = _zones[0].buddy_allocator.to_string();
+  exception::restore_irqs(flags);
+  return ret;
 }
 
 String MemoryManager::get_slob_info() const {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-  return _zones[1].slob_allocator.to_string();
+  // to_string() allocates from the zones itself, so we can't hold their locks
+  // here. Keep IRQ handlers from modifying the allocator underneath us instead.
+  const size_t flags = exception::save_and_disable_irqs();
+  String ret = _zones[1].slob_allocator.to_string();
+  exception::restore_irqs(flags);
+  return ret;
 }
 
 void MemoryManager::dump_buddy_allocator_info() const {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  const IrqSaveLockGuard<SpinLock> lock(_zones[0].lock);
   _zones[0].buddy_allocator.dump();
 }
 
 void MemoryManager::dump_slob_allocator_info() const {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  const IrqSaveLockGuard<SpinLock> lock(_zones[1].lock);
   _zones[1].slob_allocator.dump();
 }
 
 void MemoryManager::dump_kasan_info() const {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  const IrqSaveLockGuard<SpinLock> lock(_kasan_lock);
   _kasan.show();
 }
 
@@ -89,22 +101,31 @@ size_t MemoryManager::get_ram_size() const {
 int MemoryManager::inc_page_ref_count(const void *p_addr) {
   size_t idx = get_page_ref_idx(p_addr);
 
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-  return ++_ref_counts[idx];
+  return _ref_counts[idx].fetch_add(1, MemoryOrder::RELAXED) + 1;
 }
 
 int MemoryManager::dec_page_ref_count(const void *p_addr) {
   size_t idx = get_page_ref_idx(p_addr);
 
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-  return --_ref_counts[idx];
+  // Whoever drops the last reference frees the page, so it must observe
+  // all the writes made through the other references first.
+  return _ref_counts[idx].fetch_sub(1, MemoryOrder::ACQ_REL) - 1;
 }
 
 int MemoryManager::get_page_ref_count(const void *p_addr) const {
   size_t idx = get_page_ref_idx(p_addr);
 
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
-  return _ref_counts[idx];
+  return _ref_counts[idx].load(MemoryOrder::ACQUIRE);
+}
+
+void MemoryManager::mark_allocated(void *p) {
+  const IrqSaveLockGuard<SpinLock> lock(_kasan_lock);
+  _kasan.mark_allocated(p);
+}
+
+void MemoryManager::mark_free_chk(void *p) {
+  const IrqSaveLockGuard<SpinLock> lock(_kasan_lock);
+  _kasan.mark_free_chk(p);
 }
 
 int MemoryManager::get_page_ref_idx(const void *p_addr) const {
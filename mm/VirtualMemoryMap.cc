@@ -7,6 +7,11 @@
 #include <kernel/Kernel.h>
 #include <mm/MemoryManager.h>
 
+// mmap() without an address picks one from here, which is well below the
+// user stack and the vdata page, and well above the ELF segments.
+#define USER_MMAP_TOP 0x00007f0000000000
+#define USER_MMAP_BOTTOM 0x0000100000000000
+
 namespace valkyrie::kernel {
 
 VMMap::VMMap() : _pgd(reinterpret_cast<pagetable_t *>(get_free_page(true))) {
@@ -110,7 +115,10 @@ void VMMap::unmap(const size_t v_addr) const {
   void *p_addr = reinterpret_cast<void *>(page_frame_addr);
 
   *pte = 0;
-  MemoryManager::the().dec_page_ref_count(p_addr);
+
+  if (MemoryManager::the().dec_page_ref_count(p_addr) == 0) {
+    kfree(p_addr);
+  }
 }
 
 bool VMMap::is_cow_page(const size_t v_addr) const {
@@ -135,7 +143,22 @@ void *VMMap::get_physical_address(const size_t v_addr) const {
 }
 
 size_t VMMap::get_unmapped_area(size_t len) const {
-  // XXX: We should keep track of mapped areas using a tree map.
+  // XXX: We should keep track of mapped areas using a tree map. Until then,
+  // the page tables are searched top-down for the highest gap that fits.
+  // Nothing is ever unmapped, so it's usually right below the last area.
+  len = Page::align_up(len);
+  size_t end = USER_MMAP_TOP;
+
+  for (size_t v_addr = end - PAGE_SIZE; v_addr >= USER_MMAP_BOTTOM; v_addr -= PAGE_SIZE) {
+    pagetable_t *pte = walk(v_addr);
+
+    if (pte && !PD_INVALID(*pte)) {
+      end = v_addr;
+    } else if (end - v_addr >= len) {
+      return v_addr;
+    }
+  }
+
   return 0;
 }
 
@@ -199,9 +222,15 @@ void VMMap::dfs_copy_page_tables(pagetable_t *pt_old, pagetable_t *pt_new,
     }
 
     if (level == 3) {
-      // Let both parent and child share this page frame for now.
       size_t page_frame_addr = pt_old[i] & PD_PAGE_MASK;
-      pt_old[i] = pt_new[i] = page_frame_addr | USER_PAGE_RX | PD_COW_PAGE;
+
+      if ((pt_old[i] & PD_RDONLY) && !(pt_old[i] & PD_COW_PAGE)) {
+        // A read-only page (e.g., the vdata page) can be shared as it is.
+        pt_new[i] = pt_old[i];
+      } else {
+        // Let both parent and child share this page frame for now.
+        pt_old[i] = pt_new[i] = page_frame_addr | USER_PAGE_RX | PD_COW_PAGE;
+      }
 
       void *p_addr = reinterpret_cast<void *>(page_frame_addr);
       MemoryManager::the().inc_page_ref_count(p_addr);
@@ -0,0 +1,167 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <proc/FdTable.h>
+
+#include <Algorithm.h>
+#include <Mutex.h>
+#include <Utility.h>
+
+#include <fs/VirtualFileSystem.h>
+
+namespace valkyrie::kernel {
+
+FdTable::FdTable()
+    : _lock(),
+      _files(make_unique<SharedPtr<File>[]>(NR_TASK_FD_INIT)),
+      _capacity(NR_TASK_FD_INIT),
+      _used_fds(),
+      _next_fd(3) {
+  // Reserve fd 0,1,2 for stdin, stdout, stderr
+  // FIXME: refactor this BULLSHIT
+  auto opened = make_shared<File>(VFS::the().get_rootfs(), nullptr, 0);
+
+  for (int i = 0; i < 3; i++) {
+    _files[i] = opened;
+    _used_fds.set(i);
+  }
+}
+
+int FdTable::allocate(SharedPtr<File> file) {
+  const LockGuard<SpinLock> lock(_lock);
+  const size_t fd = _used_fds.find_first_zero(_next_fd);
+
+  if (fd == _used_fds.npos || !reserve(fd + 1)) [[unlikely]] {
+    return -1;
+  }
+
+  _files[fd] = move(file);
+  _used_fds.set(fd);
+  _next_fd = fd + 1;
+  return fd;
+}
+
+int FdTable::install(const int fd, SharedPtr<File> file) {
+  if (!is_valid(fd)) [[unlikely]] {
+    return -1;
+  }
+
+  SharedPtr<File> old_file;  // closed after the lock is released
+  {
+    const LockGuard<SpinLock> lock(_lock);
+
+    if (!reserve(fd + 1)) [[unlikely]] {
+      return -1;
+    }
+
+    old_file = move(_files[fd]);
+    _files[fd] = move(file);
+    _used_fds.set(fd);
+  }
+
+  return fd;
+}
+
+SharedPtr<File> FdTable::release(const int fd) {
+  if (!is_valid(fd)) [[unlikely]] {
+    return nullptr;
+  }
+
+  const LockGuard<SpinLock> lock(_lock);
+
+  if (static_cast<size_t>(fd) >= _capacity) [[unlikely]] {
+    return nullptr;
+  }
+
+  _used_fds.clear(fd);
+  _next_fd = min(_next_fd, fd);
+  return move(_files[fd]);
+}
+
+SharedPtr<File> FdTable::get(const int fd) const {
+  if (!is_valid(fd)) [[unlikely]] {
+    return nullptr;
+  }
+
+  const LockGuard<SpinLock> lock(_lock);
+
+  if (static_cast<size_t>(fd) >= _capacity) [[unlikely]] {
+    return nullptr;
+  }
+
+  return _files[fd];
+}
+
+int FdTable::find_next_used(const int fd) const {
+  if (!is_valid(fd)) [[unlikely]] {
+    return -1;
+  }
+
+  const LockGuard<SpinLock> lock(_lock);
+  const size_t ret = _used_fds.find_next_set(fd);
+  return (ret != _used_fds.npos) ? ret : -1;
+}
+
+bool FdTable::copy_from(const FdTable &other) {
+  UniquePtr<SharedPtr<File>[]> files;
+  size_t capacity;
+  Bitmap<NR_TASK_FD_LIMITS> used_fds;
+  int next_fd;
+  {
+    const LockGuard<SpinLock> lock(other._lock);
+
+    capacity = other._capacity;
+    files = make_unique<SharedPtr<File>[]>(capacity);
+
+    if (!files) [[unlikely]] {
+      return false;
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+      files[i] = other._files[i];
+    }
+
+    used_fds = other._used_fds;
+    next_fd = other._next_fd;
+  }
+
+  {
+    const LockGuard<SpinLock> lock(_lock);
+
+    swap(_files, files);
+    _capacity = capacity;
+    _used_fds = used_fds;
+    _next_fd = next_fd;
+  }
+
+  // Our old files are released along with `files`, after the lock is released.
+  return true;
+}
+
+bool FdTable::reserve(size_t capacity) {
+  if (capacity <= _capacity) [[likely]] {
+    return true;
+  }
+
+  size_t new_capacity = _capacity;
+
+  while (new_capacity < capacity) {
+    new_capacity *= 2;
+  }
+
+  new_capacity = min(new_capacity, static_cast<size_t>(NR_TASK_FD_LIMITS));
+  auto new_files = make_unique<SharedPtr<File>[]>(new_capacity);
+
+  if (!new_files) [[unlikely]] {
+    return false;
+  }
+
+  // Only the references are moved, so no file is closed here.
+  for (size_t i = 0; i < _capacity; i++) {
+    new_files[i] = move(_files[i]);
+  }
+
+  _files = move(new_files);
+  _capacity = new_capacity;
+  return true;
+}
+
+}  // namespace valkyrie::kernel
@@ -0,0 +1,126 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <proc/FpSimd.h>
+
+#include <CString.h>
+
+#include <kernel/Kernel.h>
+#include <kernel/PerCpu.h>
+#include <proc/Preempt.h>
+
+#define CPACR_EL1_FPEN_MASK (0b11 << 20)
+
+namespace valkyrie::kernel {
+
+namespace {
+
+// The context whose state is currently held by this core's registers.
+DEFINE_PER_CPU(const FpSimdContext *, fpsimd_owner);
+
+void set_fpsimd_access(const bool allowed) {
+  size_t cpacr;
+  asm volatile("mrs %0, cpacr_el1" : "=r"(cpacr));
+
+  const size_t new_cpacr =
+      allowed ? (cpacr | CPACR_EL1_FPEN_MASK) : (cpacr & ~CPACR_EL1_FPEN_MASK);
+
+  if (new_cpacr != cpacr) {
+    asm volatile("msr cpacr_el1, %0\n isb" ::"r"(new_cpacr) : "memory");
+  }
+}
+
+}  // namespace
+
+FpSimdContext::FpSimdContext() : _state() {}
+
+FpSimdContext::~FpSimdContext() {
+  preempt_disable();
+
+  // Our state in the registers is garbage now, so don't save it anywhere.
+  if (is_live()) {
+    this_cpu(fpsimd_owner) = nullptr;
+  }
+
+  preempt_enable();
+}
+
+void FpSimdContext::switch_to(const FpSimdContext &next) {
+  set_fpsimd_access(next.is_live());
+}
+
+bool FpSimdContext::load() {
+  // IRQs are disabled in the exception handler, so nothing
+  // can switch us out until the registers are ours.
+  const FpSimdContext *&owner = this_cpu(fpsimd_owner);
+
+  if (!_state) {
+    _state = make_unique<FpSimdState>();
+
+    if (!_state) [[unlikely]] {
+      printk("fpsimd: unable to allocate the save area (out of memory)\n");
+      return false;
+    }
+  }
+
+  set_fpsimd_access(true);
+
+  if (owner == this) [[unlikely]] {
+    return true;
+  }
+
+  if (owner) {
+    fpsimd_save_state(owner->_state.get());
+  }
+
+  fpsimd_load_state(_state.get());
+  owner = this;
+  return true;
+}
+
+bool FpSimdContext::copy_from(const FpSimdContext &other) {
+  if (!other._state) {
+    reset();
+    return true;
+  }
+
+  if (!_state) {
+    _state = make_unique<FpSimdState>();
+
+    if (!_state) [[unlikely]] {
+      return false;
+    }
+  }
+
+  other.flush();
+  memcpy(_state.get(), other._state.get(), sizeof(FpSimdState));
+  return true;
+}
+
+void FpSimdContext::reset() {
+  preempt_disable();
+
+  if (is_live()) {
+    this_cpu(fpsimd_owner) = nullptr;
+    set_fpsimd_access(false);
+  }
+
+  _state.reset();
+  preempt_enable();
+}
+
+bool FpSimdContext::is_live() const {
+  return this_cpu(fpsimd_owner) == this;
+}
+
+void FpSimdContext::flush() const {
+  preempt_disable();
+
+  // If the registers hold our state, then we're the current task
+  // and access to them is allowed.
+  if (is_live()) {
+    fpsimd_save_state(_state.get());
+  }
+
+  preempt_enable();
+}
+
+}  // namespace valkyrie::kernel
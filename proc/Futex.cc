@@ -0,0 +1,124 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <proc/Futex.h>
+
+#include <Mutex.h>
+
+#include <kernel/Kernel.h>
+#include <mm/mmu.h>
+
+namespace valkyrie::kernel {
+
+Futex::Futex() : _buckets() {}
+
+int Futex::wait(int *uaddr, const int val) {
+  const auto key = reinterpret_cast<size_t>(uaddr);
+  Bucket &bucket = get_bucket(key);
+  Waiter waiter{key, false, {}};
+
+  // Held until we're asleep, so that no wake() can slip in between
+  // checking the value and going to sleep (see WaitQueue::sleep_on()).
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  {
+    const LockGuard<SpinLock> bucket_lock(bucket.lock);
+
+    // The value may have changed since the user mode decided to wait,
+    // in which case whoever changed it might have already called wake().
+    if (*const_cast<volatile int *>(uaddr) != val) {
+      return -1;
+    }
+
+    bucket.waiters.push_back(&waiter);
+  }
+
+  waiter.wait_queue.sleep_on([&waiter]() { return waiter.woken; });
+  return 0;
+}
+
+int Futex::wake(int *uaddr, const int nr_wake) {
+  const auto key = reinterpret_cast<size_t>(uaddr);
+  Bucket &bucket = get_bucket(key);
+
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  const LockGuard<SpinLock> bucket_lock(bucket.lock);
+
+  return wake_waiters(bucket, key, nr_wake);
+}
+
+int Futex::requeue(int *uaddr, const int nr_wake, int *uaddr2, const int nr_requeue) {
+  const auto key = reinterpret_cast<size_t>(uaddr);
+  const auto key2 = reinterpret_cast<size_t>(uaddr2);
+  Bucket &bucket = get_bucket(key);
+  Bucket &bucket2 = get_bucket(key2);
+
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  // Always lock the two buckets in the same order to avoid an ABBA deadlock.
+  Bucket *first = (&bucket < &bucket2) ? &bucket : &bucket2;
+  Bucket *second = (&bucket < &bucket2) ? &bucket2 : &bucket;
+
+  first->lock.lock();
+  if (second != first) {
+    second->lock.lock();
+  }
+
+  const int nr_woken = wake_waiters(bucket, key, nr_wake);
+  int nr_requeued = 0;
+
+  bucket.waiters.remove_if(
+      [&](Waiter *&waiter) {
+        if (nr_requeued >= nr_requeue || waiter->key != key) {
+          return false;
+        }
+
+        // Requeuing within the same bucket would revisit the waiter.
+        if (&bucket2 == &bucket) {
+          waiter->key = key2;
+          nr_requeued++;
+          return false;
+        }
+
+        waiter->key = key2;
+        bucket2.waiters.push_back(waiter);
+        nr_requeued++;
+        return true;
+      },
+      /*check_all=*/true);
+
+  if (second != first) {
+    second->lock.unlock();
+  }
+  first->lock.unlock();
+
+  return nr_woken + nr_requeued;
+}
+
+Futex::Bucket &Futex::get_bucket(const size_t key) {
+  // The low 2 bits are always zero, and the page frame number
+  // is folded in so that the same offset in different pages
+  // doesn't always end up in the same bucket.
+  return _buckets[((key >> 2) ^ (key >> PAGE_SHIFT)) % NR_FUTEX_BUCKETS];
+}
+
+int Futex::wake_waiters(Bucket &bucket, const size_t key, const int nr_wake) {
+  int nr_woken = 0;
+
+  // Kernel::mutex is held by the caller, so the woken tasks
+  // won't run (and pop their Waiter off the stack) until we're done.
+  bucket.waiters.remove_if(
+      [&](Waiter *&waiter) {
+        if (nr_woken >= nr_wake || waiter->key != key) {
+          return false;
+        }
+
+        waiter->woken = true;
+        waiter->wait_queue.wake_up();
+        nr_woken++;
+        return true;
+      },
+      /*check_all=*/true);
+
+  return nr_woken;
+}
+
+}  // namespace valkyrie::kernel
@@ -0,0 +1,61 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <proc/Mutex.h>
+
+#include <Mutex.h>
+
+#include <kernel/Kernel.h>
+#include <proc/Task.h>
+
+namespace valkyrie::kernel {
+
+Mutex::Mutex() : _owner(), _wait_queue() {}
+
+void Mutex::lock() {
+  // During early boot there's only one thread of execution.
+  if (!exception::is_activated()) [[unlikely]] {
+    return;
+  }
+
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  Task *current = Task::current();
+
+  if (_owner == current) [[unlikely]] {
+    Kernel::panic("Mutex: recursive locking by pid %d\n", current->get_pid());
+  }
+
+  _wait_queue.sleep_on([this]() { return !_owner; });
+  _owner = current;
+}
+
+void Mutex::unlock() {
+  if (!exception::is_activated()) [[unlikely]] {
+    return;
+  }
+
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  if (_owner != Task::current()) [[unlikely]] {
+    Kernel::panic("Mutex: unlocked by pid %d, which isn't the owner\n",
+                  Task::current()->get_pid());
+  }
+
+  _owner = nullptr;
+  _wait_queue.wake_up();
+}
+
+bool Mutex::try_lock() {
+  if (!exception::is_activated()) [[unlikely]] {
+    return true;
+  }
+
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  if (_owner) {
+    return false;
+  }
+
+  _owner = Task::current();
+  return true;
+}
+
+}  // namespace valkyrie::kernel
@@ -0,0 +1,64 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <proc/PidMap.h>
+
+#include <Hash.h>
+
+namespace valkyrie::kernel {
+
+PidMap::PidMap() : _lock(), _bitmap(), _last_pid(-1), _pid_hash(), _all_tasks() {}
+
+pid_t PidMap::allocate() {
+  const LockGuard<SpinLock> lock(_lock);
+
+  size_t pid = _bitmap.find_first_zero(_last_pid + 1);
+
+  if (pid == Bitmap<PID_MAX>::npos) [[unlikely]] {
+    pid = _bitmap.find_first_zero();
+  }
+
+  if (pid == Bitmap<PID_MAX>::npos) [[unlikely]] {
+    return -1;
+  }
+
+  _bitmap.set(pid);
+  _last_pid = pid;
+  return pid;
+}
+
+void PidMap::release(const pid_t pid) {
+  const LockGuard<SpinLock> lock(_lock);
+
+  _bitmap.clear(pid);
+}
+
+void PidMap::attach(Task &task) {
+  const LockGuard<SpinLock> lock(_lock);
+
+  _pid_hash[hash(task._pid) % PID_HASH_SIZE].push_back(task);
+  _all_tasks.push_back(task);
+}
+
+void PidMap::detach(Task &task) {
+  const LockGuard<SpinLock> lock(_lock);
+
+  if (task._all_tasks_node.is_linked()) {
+    PidHashList::remove(task);
+    TaskList::remove(task);
+  }
+}
+
+Task *PidMap::find(const pid_t pid) {
+  const LockGuard<SpinLock> lock(_lock);
+  Task *ret = nullptr;
+
+  // Each bucket only holds about (nr_tasks / PID_HASH_SIZE) tasks.
+  _pid_hash[hash(pid) % PID_HASH_SIZE].for_each([pid, &ret](Task &task) {
+    if (task._pid == pid) {
+      ret = &task;
+    }
+  });
+
+  return ret;
+}
+
+}  // namespace valkyrie::kernel
@@ -0,0 +1,36 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <proc/RCU.h>
+
+#include <proc/TaskScheduler.h>
+
+namespace valkyrie::kernel {
+
+RCU::RCU() : _nr_quiescent_states() {}
+
+void RCU::synchronize() {
+  const size_t self = this_cpu_block().cpu_id;
+  uint64_t snapshots[NR_CPUS];
+
+  for (size_t cpu = 0; cpu < NR_CPUS; cpu++) {
+    snapshots[cpu] = per_cpu(_nr_quiescent_states, cpu).load(MemoryOrder::ACQUIRE);
+  }
+
+  // The calling core can't be in a read-side critical section, so it's
+  // already quiescent. Every other core has to pass a quiescent state.
+  for (size_t cpu = 0; cpu < NR_CPUS; cpu++) {
+    while (cpu != self &&
+           per_cpu(_nr_quiescent_states, cpu).load(MemoryOrder::ACQUIRE) == snapshots[cpu]) {
+      TaskScheduler::the().schedule();
+    }
+  }
+
+  // Don't let the caller free the old version before the above.
+  asm volatile("dmb ish" ::: "memory");
+}
+
+void RCU::note_quiescent_state() {
+  // Everything the readers on this core did must happen before this.
+  this_cpu(_nr_quiescent_states).fetch_add(1, MemoryOrder::RELEASE);
+}
+
+}  // namespace valkyrie::kernel
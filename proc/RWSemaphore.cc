@@ -0,0 +1,83 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <proc/RWSemaphore.h>
+
+#include <Mutex.h>
+
+#include <kernel/Kernel.h>
+#include <proc/Task.h>
+
+namespace valkyrie::kernel {
+
+RWSemaphore::RWSemaphore()
+    : _writer(),
+      _nr_readers(),
+      _nr_waiting_writers(),
+      _readers_wait_queue(),
+      _writers_wait_queue() {}
+
+void RWSemaphore::lock() {
+  // During early boot there's only one thread of execution.
+  if (!exception::is_activated()) [[unlikely]] {
+    return;
+  }
+
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  _nr_waiting_writers++;
+  _writers_wait_queue.sleep_on([this]() { return !_writer && !_nr_readers; });
+  _nr_waiting_writers--;
+
+  _writer = Task::current();
+}
+
+void RWSemaphore::unlock() {
+  if (!exception::is_activated()) [[unlikely]] {
+    return;
+  }
+
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  if (_writer != Task::current()) [[unlikely]] {
+    Kernel::panic("RWSemaphore: unlocked by pid %d, which isn't the writer\n",
+                  Task::current()->get_pid());
+  }
+
+  _writer = nullptr;
+
+  // Hand it over to the next writer if there is one, otherwise let
+  // all the readers in.
+  if (_nr_waiting_writers) {
+    _writers_wait_queue.wake_up();
+  } else {
+    _readers_wait_queue.wake_up_all();
+  }
+}
+
+void RWSemaphore::lock_shared() {
+  if (!exception::is_activated()) [[unlikely]] {
+    return;
+  }
+
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  _readers_wait_queue.sleep_on([this]() { return !_writer && !_nr_waiting_writers; });
+  _nr_readers++;
+}
+
+void RWSemaphore::unlock_shared() {
+  if (!exception::is_activated()) [[unlikely]] {
+    return;
+  }
+
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  if (!_nr_readers) [[unlikely]] {
+    Kernel::panic("RWSemaphore: unlock_shared() without any reader\n");
+  }
+
+  if (!--_nr_readers && _nr_waiting_writers) {
+    _writers_wait_queue.wake_up();
+  }
+}
+
+}  // namespace valkyrie::kernel
@@ -9,6 +9,9 @@
 #include <fs/VirtualFileSystem.h>
 #include <kernel/Kernel.h>
 #include <kernel/Syscall.h>
+#include <proc/PidMap.h>
+#include <proc/Preempt.h>
+#include <proc/RCU.h>
 #include <proc/TaskScheduler.h>
 
 #define INIT_PATH "/sbin/init"
@@ -24,18 +27,27 @@ Task::Task(bool is_user_task, Task *parent, void (*entry_point)(), const char *n
       _parent(parent),
       _active_children(),
       _terminated_children(),
+      _child_exit_wait_queue(),
       _state(Task::State::CREATED),
       _error_code(),
-      _pid(Task::_next_pid++),
+      _pid(PidMap::the().allocate()),
+      _pid_hash_node(),
+      _all_tasks_node(),
       _time_slice(TASK_TIME_SLICE),
-      _vmmap(),
+      _preempt_count(),
+      _bkl_state(),
+      _policy(SCHED_NORMAL),
+      _rt_priority(),
+      _wakeup_timestamp(),
+      _vmmap(make_shared<VMMap>()),
       _entry_point(entry_point),
       _kstack_page(get_free_page(/*physical=*/true)),
       _ustack_page(get_free_page(/*physical=*/true)),
+      _fpsimd_context(),
       _name(),
       _pending_signals(),
-      _custom_signal_handlers(),
-      _fd_table(),
+      _custom_signal_handlers(make_shared<SignalHandlerTable>()),
+      _fd_table(make_shared<FdTable>()),
       _cwd_vnode(VFS::the().get_rootfs().get_root_vnode()) {
   if (_pid == 1) [[unlikely]] {
     Task::_init = this;
@@ -47,18 +59,16 @@ Task::Task(bool is_user_task, Task *parent, void (*entry_point)(), const char *n
     parent->_active_children.push_back(this);
   }
 
+  // The idle task (pid 0) can't be looked up, so it can't be signaled either.
+  if (_pid > 0) [[likely]] {
+    PidMap::the().attach(*this);
+  }
+
   _context.lr = reinterpret_cast<size_t>(entry_point);
   _context.sp = _kstack_page.end();
 
   strcpy(_name, name);
 
-  // Reserve fd 0,1,2 for stdin, stdout, stderr
-  // FIXME: refactor this BULLSHIT
-  auto opened = make_shared<File>(VFS::the().get_rootfs(), nullptr, 0);
-  _fd_table[0] = opened;
-  _fd_table[1] = opened;
-  _fd_table[2] = opened;
-
 #ifdef DEBUG
   printk(
       "constructed thread 0x%x [%s] (pid = %d): entry: 0x%x, _kstack_page = 0x%p, "
@@ -81,76 +91,41 @@ Task::~Task() {
     _active_children.pop_front();
   }
 
+  // Our pid can't be reused until our parent has reaped us.
+  if (_pid >= 0) [[likely]] {
+    PidMap::the().detach(*this);
+    PidMap::the().release(_pid);
+  }
+
   kfree(_kstack_page.p_addr());
 }
 
 List<Task *> Task::get_active_tasks() {
   List<Task *> ret;
-  ret.push_back(Task::_init);
-  ret.push_back(Task::_kthreadd);
-
-  // Process tree BFS
-  List<Task *> q;
-  q.push_back(Task::_init);
-
-  while (!q.empty()) {
-    size_t size = q.size();
-
-    for (size_t i = 0; i < size; i++) {
-      Task *task = q.front();
-      q.pop_front();
-
-      ret.push_back(task);
-
-      // Push all children onto the queue.
-      for (const auto &child : task->_active_children) {
-        q.push_back(child);
-      }
-    }
-  }
-
+  PidMap::the().for_each_task([&ret](Task &task) { ret.push_back(&task); });
   return ret;
 }
 
 Task *Task::get_by_pid(const pid_t pid) {
-  if (pid == 1) {
-    return Task::_init;
-  } else if (pid == 2) {
-    return Task::_kthreadd;
-  }
-
-  // Process tree BFS
-  List<Task *> q;
-  q.push_back(Task::_init);
-
-  while (!q.empty()) {
-    size_t size = q.size();
-
-    for (size_t i = 0; i < size; i++) {
-      Task *task = q.front();
-      q.pop_front();
-
-      auto it = task->_active_children.find_if([pid](auto t) { return t->_pid == pid; });
-
-      if (it != task->_active_children.end()) {
-        return *it;
-      }
-
-      // Push all children onto the queue.
-      for (const auto &child : task->_active_children) {
-        q.push_back(child);
-      }
-    }
-  }
-
-  return nullptr;
+  return PidMap::the().find(pid);
 }
 
 int Task::fork() {
+  return clone(/*flags=*/0, /*stack=*/nullptr, /*tls=*/nullptr);
+}
+
+int Task::clone(unsigned long flags, void __user *stack, void __user *tls) {
 #ifdef DEBUG
-  printk("Task::fork(): Forking from: %s (pid = %d)\n", get_name(), get_pid());
+  printk("Task::clone(): Cloning from: %s (pid = %d), flags = 0x%x\n", get_name(), get_pid(),
+         flags);
 #endif
 
+  // Sharing the signal handlers only makes sense within one address space.
+  if ((flags & CLONE_SIGHAND) && !(flags & CLONE_VM)) [[unlikely]] {
+    printk("Task::clone(): CLONE_SIGHAND requires CLONE_VM\n");
+    return -1;
+  }
+
   const LockGuard<RecursiveMutex> lock(Kernel::mutex);
 
   save_context();
@@ -167,33 +142,75 @@ int Task::fork() {
   Task *child = task.get();
 
   if (!task) {
-    printk("Task::fork(): task object allocation failed (out of memory).\n");
+    printk("Task::clone(): task object allocation failed (out of memory).\n");
+    ret = -1;
+    goto out;
+  }
+
+  if (task->_pid < 0) {
+    printk("Task::clone(): pid allocation failed (out of pids).\n");
     ret = -1;
     goto out;
   }
 
   if (!task->_kstack_page.p_addr()) {
-    printk("Task::fork(): kernel stack allocation failed (out of memory).\n");
+    printk("Task::clone(): kernel stack allocation failed (out of memory).\n");
     ret = -1;
     goto out;
   }
 
   if (!task->_ustack_page.p_addr()) {
-    printk("Task::fork(): user stack allocation failed (out of memory).\n");
+    printk("Task::clone(): user stack allocation failed (out of memory).\n");
+    ret = -1;
+    goto out;
+  }
+
+  if (!task->_fpsimd_context.copy_from(_fpsimd_context)) {
+    printk("Task::clone(): FP/SIMD state allocation failed (out of memory).\n");
+    ret = -1;
+    goto out;
+  }
+
+  // The child inherits the scheduling policy of its parent.
+  task->_policy = _policy;
+  task->_rt_priority = _rt_priority;
+
+  if (flags & CLONE_VM) {
+    task->_vmmap = _vmmap;
+  } else {
+    // Clone the page table using copy-on-write.
+    task->_vmmap->copy_from(*_vmmap);
+  }
+
+  // Without CLONE_FILES, the child gets a copy of the fd table, whose fds
+  // still refer to the same open file descriptions (and thus file offsets).
+  if (flags & CLONE_FILES) {
+    task->_fd_table = _fd_table;
+  } else if (!task->_fd_table->copy_from(*_fd_table)) [[unlikely]] {
+    printk("Task::clone(): fd table allocation failed (out of memory).\n");
     ret = -1;
     goto out;
   }
 
+  if (flags & CLONE_SIGHAND) {
+    task->_custom_signal_handlers = _custom_signal_handlers;
+  } else {
+    *task->_custom_signal_handlers = *_custom_signal_handlers;
+  }
+
   // Enqueue the child task.
   TaskScheduler::the().enqueue_task(move(task));
 
   // Clone kernel/user stack content
   child->_kstack_page.copy_from(_kstack_page);
-  child->_ustack_page.copy_from(_ustack_page);
+
+  if (!(flags & CLONE_VM)) {
+    child->_ustack_page.copy_from(_ustack_page);
+  }
 
   // ------ You can safely modify the child now ------
 
-  // Set parent's fork() return value to child's pid.
+  // Set parent's clone() return value to child's pid.
   ret = child->_pid;
 
   // Clone child's CPU context.
@@ -201,8 +218,9 @@ int Task::fork() {
   child->_context.lr = reinterpret_cast<uint64_t>(&&out);
   child->_context.sp = child->_kstack_page.add_offset(kernel_sp_offset);
 
-  // Clone the page table using copy-on-write.
-  child->_vmmap.copy_from(_vmmap);
+  if (flags & CLONE_SETTLS) {
+    child->_context.tpidr_el0 = reinterpret_cast<uint64_t>(tls);
+  }
 
   // Calculate child's trap frame.
   // When the child returns from kernel mode to user mode,
@@ -210,11 +228,13 @@ int Task::fork() {
   // and used as the user mode SP.
   child->_trap_frame = child->_kstack_page.add_offset<TrapFrame *>(trap_frame_offset);
 
+  if (stack) {
+    child->_trap_frame->sp_el0 = reinterpret_cast<uint64_t>(stack);
+  }
+
   // Clone current working directory vnode.
   child->_cwd_vnode = _cwd_vnode;
 
-  // TODO: Clone fd table
-
 out:
   return ret;
 }
@@ -259,9 +279,17 @@ int Task::exec(const char *name, const char *const _argv[]) {
   // Reset the stack pointer.
   _context.sp = user_sp;
 
-  // Release the vmmap, freeing the old _ustack_page.
-  _vmmap.reset();
-  _vmmap.map(USER_STACK_PAGE, _ustack_page.p_addr(), USER_PAGE_RW);
+  // Release the vmmap, freeing the old _ustack_page. If it's shared with
+  // other threads, leave it to them and start over with a new one.
+  if (_vmmap.use_count() > 1) {
+    _vmmap = make_shared<VMMap>();
+    _custom_signal_handlers = make_shared<SignalHandlerTable>();
+  } else {
+    _vmmap->reset();
+  }
+
+  _vmmap->map(USER_STACK_PAGE, _ustack_page.p_addr(), USER_PAGE_RW);
+  Clock::the().map_vdata_page(*_vmmap);
   _ustack_page = new_ustack_page;
 
   // Invoke the kernel's ELF loader.
@@ -270,44 +298,77 @@ int Task::exec(const char *name, const char *const _argv[]) {
 
   VFS::the().close(move(file));
 
+  // The new program starts with zeroed FP/SIMD registers.
+  _fpsimd_context.reset();
+
 #ifdef DEBUG
   printk(
       "executing new program: %s <0x%p>, "
       "_kstack_page = 0x%p, _ustack_page = 0x%p, page_table = 0x%p\n",
-      _name, entry_point, _kstack_page.begin(), _ustack_page.begin(), _vmmap.get_pgd());
+      _name, entry_point, _kstack_page.begin(), _ustack_page.begin(), _vmmap->get_pgd());
 #endif
 
+  // The TLS pointer of the old program means nothing to the new one.
+  asm volatile("msr tpidr_el0, xzr");
+
   // Jump to the entry point.
-  switch_to_user_mode(entry_point, user_sp, kernel_sp, _vmmap.get_pgd());
+  switch_to_user_mode(entry_point, user_sp, kernel_sp, _vmmap->get_pgd());
 
 failed:
   printk("Task::exec() failed: [%s], pid [%d], name [%s], err [%s].\n", name, _pid, _name, reason);
   return -1;
 }
 
-int Task::wait(int *wstatus) {
+int Task::wait(const pid_t pid, int *wstatus) {
   const LockGuard<RecursiveMutex> lock(Kernel::mutex);
 
-  if (!get_children_count()) {
+  auto is_awaited = [pid](const auto &child) {
+    return pid == static_cast<pid_t>(-1) || child->_pid == pid;
+  };
+
+  if (_active_children.find_if(is_awaited) == _active_children.end() &&
+      _terminated_children.find_if(is_awaited) == _terminated_children.end()) {
     return -1;
   }
 
-  // Suspends execution of the calling thread until one of its children terminates.
-  while (_terminated_children.empty()) {
-    TaskScheduler::the().schedule();
-  }
+  // Suspends execution of the calling thread until the child terminates.
+  auto it = _terminated_children.end();
+  _child_exit_wait_queue.sleep_on([this, &it, &is_awaited]() {
+    it = _terminated_children.find_if(is_awaited);
+    return it != _terminated_children.end();
+  });
 
-  auto &child = _terminated_children.front();
+  auto &child = *it;
 
   if (wstatus) {
     *wstatus = child->_error_code;
   }
 
   int ret = child->_pid;
-  _terminated_children.pop_front();
+  _terminated_children.erase(it.index());
   return ret;
 }
 
+int Task::nanosleep(const uint64_t ns) {
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  // The task is taken off the runqueue until a one-shot timer fires.
+  // RT tasks get no timer slack, so their wakeups are as precise as possible.
+  const uint64_t deadline = ARMCoreTimer::get_counter() + ARMCoreTimer::ns_to_counter(ns);
+  const uint64_t slack_ns = is_rt_task() ? 0 : TIMER_DEFAULT_SLACK_NS;
+
+  WaitQueue wait_queue;
+  bool expired = false;
+  TimerMultiplexer::Event event([&wait_queue, &expired]() {
+    expired = true;
+    wait_queue.wake_up();
+  });
+
+  TimerMultiplexer::the().add_timer_at(event, deadline, slack_ns);
+  wait_queue.sleep_on([&expired]() { return expired; });
+  return 0;
+}
+
 [[noreturn]] void Task::exit(int error_code) {
   if (!_parent) [[unlikely]] {
     Kernel::panic("Attempted to kill %s! exit code=0x%08x\n", _name, error_code);
@@ -317,18 +378,18 @@ int Task::wait(int *wstatus) {
   _state = Task::State::TERMINATED;
   _error_code = error_code;
 
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  // Drop our reference to the fd table. Whoever drops the last one (which
+  // may be us) closes the unclosed fds along with the table, even if some
+  // of the tasks sharing it have exited but haven't been reaped yet.
+  _fd_table.reset();
 
-  // Close unclosed fds
-  for (int i = 3; i < NR_TASK_FD_LIMITS; i++) {
-    if (_fd_table[i]) {
-      sys_close(i);
-    }
-  }
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
 
   auto &sched = TaskScheduler::the();
   _parent->_active_children.remove(this);
+  PidMap::the().detach(*this);
   _parent->_terminated_children.push_back(sched.remove_task(*this));
+  _parent->_child_exit_wait_queue.wake_up_all();
 
   sched.schedule();
   Kernel::panic("sys_exit: returned from sched.\n");
@@ -362,7 +423,7 @@ int Task::signal(int signal, void (*handler)(int)) {
     return -1;
   }
 
-  _custom_signal_handlers[signal] = handler;
+  _custom_signal_handlers->handlers[signal] = handler;
   return 0;  // TODO: return previous handler's error code.
 }
 
@@ -377,7 +438,6 @@ void __user *Task::do_mmap(void __user *addr, size_t len, int prot, int flags,
   const LockGuard<RecursiveMutex> lock(Kernel::mutex);
   void __user *ret_err = reinterpret_cast<void *>(-1UL);
   size_t v_addr = reinterpret_cast<size_t>(addr);
-  size_t old_file_pos = 0;
 
   // The user wants to create a file-backed memory mapping,
   // but the specified `file` is invalid.
@@ -394,8 +454,11 @@ void __user *Task::do_mmap(void __user *addr, size_t len, int prot, int flags,
   len = Page::align_up(len);
 
   if (!v_addr) {
-    printk("Warning: do_mmap_internal(): addr == nullptr, not implemented yet!\n");
-    v_addr = _vmmap.get_unmapped_area(len);
+    v_addr = _vmmap->get_unmapped_area(len);
+
+    if (!v_addr) [[unlikely]] {
+      return ret_err;
+    }
   } else {
     v_addr = Page::align_down(v_addr);
   }
@@ -412,8 +475,50 @@ void __user *Task::do_mmap(void __user *addr, size_t len, int prot, int flags,
     attr &= ~PD_EL0_EXEC_NEVER;
   }
 
+  // The pages which are mapped just as they are in the file share their page
+  // frames with the page cache. If the mapping is writable, they are mapped
+  // read-only and copy-on-write, so the first write to one of them faults
+  // and gets a copy of its own (see VMMap::copy_page_frame()). The page
+  // cache holds a reference too, so the frame is never written in place.
+  if (!(flags & MAP_ANONYMOUS) && zero_page_file_offset == static_cast<size_t>(-1) &&
+      Page::is_aligned(file_offset) && file->vnode->is_page_cacheable()) {
+    const LockGuard<Mutex> vnode_lock(file->vnode->get_lock());
+    AddressSpace &mapping = file->vnode->get_mapping();
+    const size_t nr_file_pages = Page::align_up(file->vnode->get_size()) / PAGE_SIZE;
+    const size_t cached_page_attr =
+        (prot & PROT_WRITE) ? attr | PD_RDONLY | PD_COW_PAGE : attr;
+
+    for (size_t i = 0; i < len / PAGE_SIZE; i++) {
+      const size_t index = file_offset / PAGE_SIZE + i;
+
+      if (index < nr_file_pages) {
+        if (void *page_frame_addr = mapping.get_page(index)) [[likely]] {
+          _vmmap->map(v_addr + i * PAGE_SIZE, page_frame_addr, cached_page_attr);
+          continue;
+        }
+      } else {
+        // The pages past EOF are zero-filled, and kept out of the page cache.
+        if (void *page_frame_addr = get_free_page(/*physical=*/true)) [[likely]] {
+          memset(page_frame_addr, 0, PAGE_SIZE);
+          _vmmap->map(v_addr + i * PAGE_SIZE, page_frame_addr, attr);
+          continue;
+        }
+      }
+
+      // Out of memory. Undo the pages mapped so far.
+      for (size_t j = 0; j < i; j++) {
+        _vmmap->unmap(v_addr + j * PAGE_SIZE);
+      }
+      return ret_err;
+    }
+
+    return reinterpret_cast<void __user *>(v_addr);
+  }
+
+  // Read the file through an open file description of our own,
+  // so that the offset of `file`, which other tasks may share, is left alone.
   if (!(flags & MAP_ANONYMOUS)) {
-    old_file_pos = file->pos;
+    file = make_shared<File>(file->fs, file->vnode, file->options);
     file->pos = file_offset;
   }
 
@@ -421,7 +526,7 @@ void __user *Task::do_mmap(void __user *addr, size_t len, int prot, int flags,
   bool is_first_time_zeroing = true;
   for (size_t i = 0; len; i++, len -= PAGE_SIZE) {
     void *page_frame_addr = get_free_page(/*physical=*/true);
-    _vmmap.map(v_addr + i * PAGE_SIZE, page_frame_addr, attr);
+    _vmmap->map(v_addr + i * PAGE_SIZE, page_frame_addr, attr);
 
     // POSIX requires that mmap() zero any memory that it allocates.
     memset(page_frame_addr, 0, PAGE_SIZE);
@@ -446,10 +551,6 @@ void __user *Task::do_mmap(void __user *addr, size_t len, int prot, int flags,
     }
   }
 
-  if (!(flags & MAP_ANONYMOUS)) {
-    file->pos = old_file_pos;
-  }
-
   return reinterpret_cast<void __user *>(v_addr);
 }
 
@@ -479,7 +580,6 @@ bool Task::load_elf_binary(SharedPtr<File> file, ELF &elf) {
     printk("   * filesz: 0x%p\n", segment.physical_size);
     printk("   * memsz: 0x%p\n", segment.virtual_size);
     printk("   * align: 0x%p\n", segment.alignment);
-    printk("   * content: 0x%p\n", segment.get_content(elf.get_base()));
 #endif
 
     map_elf_segment(file, elf, segment);
@@ -605,7 +705,7 @@ void Task::handle_pending_signals() {
       Kernel::panic("invalid signal: 0x%x\n", signal);
     }
 
-    if (!_custom_signal_handlers[signal]) {
+    if (!_custom_signal_handlers->handlers[signal]) {
       execute_default_signal_handler(signal);
     } else {
       execute_custom_signal_handler(signal);
@@ -622,8 +722,8 @@ void Task::execute_custom_signal_handler(const Signal signal) {
   // Custom signal handlers should be run in the user mode.
   // TODO: pass `signal` to the user's custom signal handler.
   Kernel::panic("not implemented yet!\n");
-  //void *signal_handler = reinterpret_cast<void *>(_custom_signal_handlers[signal]);
-  //switch_to_user_mode(signal_handler, 0, 0, _vmmap.get_pgd());
+  //void *signal_handler = reinterpret_cast<void *>(_custom_signal_handlers->handlers[signal]);
+  //switch_to_user_mode(signal_handler, 0, 0, _vmmap->get_pgd());
 }
 
 int Task::allocate_fd_for_file(SharedPtr<File> file) {
@@ -631,32 +731,44 @@ int Task::allocate_fd_for_file(SharedPtr<File> file) {
     Kernel::panic("Task::allocate_fd_for_file(): file is nullptr\n");
   }
 
-  for (int i = 0; i < NR_TASK_FD_LIMITS; i++) {
-    if (!_fd_table[i]) {
-      _fd_table[i] = move(file);
-      return i;
-    }
+  const int fd = _fd_table->allocate(move(file));
+
+  if (fd == -1) [[unlikely]] {
+    printk("warning: task (pid = %d) has reached fd limits!\n", _pid);
   }
 
-  printk("warning: task (pid = %d) has reached fd limits!\n", _pid);
-  return -1;
+  return fd;
+}
+
+int Task::install_file_at_fd(const int fd, SharedPtr<File> file) {
+  if (!file) [[unlikely]] {
+    Kernel::panic("Task::install_file_at_fd(): file is nullptr\n");
+  }
+
+  return _fd_table->install(fd, move(file));
 }
 
 SharedPtr<File> Task::release_fd_and_get_file(const int fd) {
-  return is_fd_valid(fd) ? move(_fd_table[fd]) : nullptr;
+  return _fd_table->release(fd);
 }
 
 SharedPtr<File> Task::get_file_by_fd(const int fd) const {
-  return is_fd_valid(fd) ? _fd_table[fd] : nullptr;
+  return _fd_table->get(fd);
 }
 
 bool Task::is_fd_valid(const int fd) const {
-  return fd >= 0 && fd < NR_TASK_FD_LIMITS;
+  return FdTable::is_valid(fd);
 }
 
 // Built-in tasks entry points.
 [[noreturn]] void idle() {
   while (true) {
+    // The idle task only runs when nothing else is runnable, so halt the core
+    // until the next interrupt, which may wake up some task and preempt us.
+    // An idle core is never in an RCU read-side critical section.
+    RCU::the().note_quiescent_state();
+    exception::enable_irqs();
+    asm volatile("wfi");
     TaskScheduler::the().schedule();
   }
 }
@@ -670,10 +782,15 @@ bool Task::is_fd_valid(const int fd) const {
 }
 
 [[noreturn]] void start_kthreadd() {
+  Task *kthreadd = Task::current();
+
   while (true) {
-    // Wait for any kthread to terminate.
-    Task::current()->wait(nullptr);
-    TaskScheduler::the().schedule();
+    const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+    // Sleep until any kthread terminates, and then reap it.
+    kthreadd->_child_exit_wait_queue.sleep_on(
+        [kthreadd]() { return !kthreadd->_terminated_children.empty(); });
+    kthreadd->_terminated_children.pop_front();
   }
 }
 
@@ -1,27 +1,64 @@
 // Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include <proc/TaskScheduler.h>
 
-#include <Mutex.h>
+#include <Algorithm.h>
+#include <SpinLock.h>
 
 #include <dev/Console.h>
 #include <kernel/Kernel.h>
+#include <kernel/Timer.h>
+#include <kernel/TimerMultiplexer.h>
+#include <proc/Preempt.h>
+#include <proc/RCU.h>
 
 namespace valkyrie::kernel {
 
-TaskScheduler::TaskScheduler() : _need_reschedule(), _runqueue() {}
+TaskScheduler::TaskScheduler()
+    : _runqueue_lock(),
+      _idle_task(),
+      _runqueue(),
+      _rt_runqueues(),
+      _rt_bitmap(),
+      _nr_rt_wakeups(),
+      _last_rt_wakeup_latency(),
+      _max_rt_wakeup_latency(),
+      _start_timestamp(),
+      _idle_enter_timestamp(),
+      _idle_time(),
+      _nr_idle_entries(),
+      _nr_kernel_preemptions() {}
 
 void TaskScheduler::run() {
-  if (_runqueue.empty()) [[unlikely]] {
+  Task *next = pick_next_task();
+
+  if (!next) [[unlikely]] {
     Kernel::panic("No tasks in runqueue!\n");
   }
 
+  _start_timestamp = ARMCoreTimer::get_counter();
+
   // Switch to the first task.
-  switch_to(/*prev=*/nullptr, /*next=*/_runqueue.front().get());
+  next->set_state(Task::State::RUNNING);
+  TimerMultiplexer::the().reprogram(is_tick_needed(*next));
+  switch_to(/*prev=*/nullptr, /*next=*/next);
+}
+
+void TaskScheduler::set_idle_task(UniquePtr<Task> task) {
+  task->set_state(Task::State::RUNNING);
+  _idle_task = move(task);
 }
 
 void TaskScheduler::enqueue_task(UniquePtr<Task> task) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  const IrqSaveLockGuard<SpinLock> lock(_runqueue_lock);
+  do_enqueue_task(move(task));
+}
 
+UniquePtr<Task> TaskScheduler::remove_task(const Task &task) {
+  const IrqSaveLockGuard<SpinLock> lock(_runqueue_lock);
+  return do_remove_task(task);
+}
+
+void TaskScheduler::do_enqueue_task(UniquePtr<Task> task) {
   if (!task) [[unlikely]] {
     Kernel::panic("sched: task is empty\n");
   }
@@ -32,20 +69,32 @@ void TaskScheduler::enqueue_task(UniquePtr<Task> task) {
 #endif
 
   task->set_state(Task::State::RUNNING);
-  _runqueue.push_back(move(task));
-}
 
-UniquePtr<Task> TaskScheduler::remove_task(const Task &task) {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+  if (should_preempt_current(*task)) {
+    set_need_resched();
+  }
+
+  if (task->is_rt_task()) {
+    task->_wakeup_timestamp = ARMCoreTimer::get_counter();
+    _rt_bitmap.set(task->get_rt_priority());
+  }
+
+  get_runqueue(*task).push_back(move(task));
 
+  // The current task may have to share the CPU with this one from now on.
+  update_tick();
+}
+
+UniquePtr<Task> TaskScheduler::do_remove_task(const Task &task) {
   UniquePtr<Task> removed_task;
+  auto &runqueue = get_runqueue(task);
 
 #ifdef DEBUG
   printk("sched: removing thread from the runqueue 0x%x [%s] (pid = %d)\n", &task,
          task.get_name(), task.get_pid());
 #endif
 
-  _runqueue.remove_if([&removed_task, &task](auto &t) {
+  runqueue.remove_if([&removed_task, &task](auto &t) {
     return t.get() == &task && (removed_task = move(t), true);
   });
 
@@ -53,55 +102,278 @@ UniquePtr<Task> TaskScheduler::remove_task(const Task &task) {
     Kernel::panic("sched: removed_task is empty\n");
   }
 
+  if (task.is_rt_task() && runqueue.empty()) {
+    _rt_bitmap.clear(task.get_rt_priority());
+  }
+
   return removed_task;
 }
 
-void TaskScheduler::schedule() {
-  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+int TaskScheduler::set_scheduler(Task &task, int policy, int rt_priority) {
+  const bool is_rt_policy = policy == SCHED_FIFO || policy == SCHED_RR;
 
-  // Maybe move the first task in the runqueue to the end.
-  if (_runqueue.size() > 1) [[likely]] {
-    auto task = move(_runqueue.front());
-    _runqueue.pop_front();
-    _runqueue.push_back(move(task));
+  if (!is_rt_policy && policy != SCHED_NORMAL) [[unlikely]] {
+    printk("sched: invalid scheduling policy: %d\n", policy);
+    return -1;
+  }
 
-#ifdef DEBUG
-    auto &next_task = _runqueue.front();
-    printf(">>>> context switch: next: pid = %d [%s], SP = 0x%p\n", next_task->get_pid(),
-           next_task->get_name(), next_task->_context.sp);
-#endif
+  if ((is_rt_policy && (rt_priority < 1 || rt_priority >= MAX_RT_PRIO)) ||
+      (!is_rt_policy && rt_priority != 0)) [[unlikely]] {
+    printk("sched: invalid rt priority %d for policy %d\n", rt_priority, policy);
+    return -1;
+  }
+
+  const IrqSaveLockGuard<SpinLock> lock(_runqueue_lock);
+
+  // A sleeping task will be put onto the right runqueue when it's woken up.
+  if (task.get_state() == Task::State::SLEEPING) {
+    task._policy = policy;
+    task._rt_priority = rt_priority;
+    task._time_slice = TASK_TIME_SLICE;
+    return 0;
   }
 
-  // Update task states.
-  Task::current()->set_state(Task::State::SLEEPING);
-  _runqueue.front()->set_state(Task::State::RUNNING);
+  // Otherwise, move the task over to the runqueue of its new priority.
+  UniquePtr<Task> t = do_remove_task(task);
+  t->_policy = policy;
+  t->_rt_priority = rt_priority;
+  t->_time_slice = TASK_TIME_SLICE;
+  do_enqueue_task(move(t));
+
+  // The current task may no longer be the most eligible one.
+  set_need_resched();
+  return 0;
+}
+
+void TaskScheduler::schedule() {
+  const size_t flags = exception::save_and_disable_irqs();
+
+  // The current task voluntarily gives up the CPU,
+  // so it goes to the back of its runqueue.
+  _runqueue_lock.lock();
+  this_cpu_block().need_resched = false;
+  requeue_task(*Task::current());
+  switch_to_next_task();
 
-  switch_to(Task::current(), _runqueue.front().get());
+  exception::restore_irqs(flags);
 }
 
 void TaskScheduler::maybe_schedule() {
-  if (!_need_reschedule) {
+  // Never preempt a task which has disabled preemption, e.g., one that
+  // has been interrupted while holding a spinlock. It will reschedule
+  // by itself once it enables preemption again.
+  if (!need_resched() || preempt_count()) {
     return;
   }
 
-  _need_reschedule = false;
-  Task::current()->set_time_slice(TASK_TIME_SLICE);
+  const size_t flags = exception::save_and_disable_irqs();
+
+  _runqueue_lock.lock();
+  this_cpu_block().need_resched = false;
+
+  // A task that has used up its time slice goes to the back of its runqueue.
+  // A task that is preempted by a higher-priority task stays at the head,
+  // so it resumes first once the higher-priority task is done.
+  auto current = Task::current();
+
+  if (current->get_time_slice() <= 0) {
+    current->set_time_slice(TASK_TIME_SLICE);
+    requeue_task(*current);
+  }
 
 #ifdef DEBUG
-  printk("Preempting current task @0x%p... (pid = %d)\n", Task::current(),
-         Task::current()->get_pid());
+  printk("Preempting current task @0x%p... (pid = %d)\n", current, current->get_pid());
 #endif
 
-  schedule();
+  switch_to_next_task();
+
+  exception::restore_irqs(flags);
+}
+
+void preempt_schedule() {
+  auto &sched = TaskScheduler::the();
+
+  sched._nr_kernel_preemptions.fetch_add(1, MemoryOrder::RELAXED);
+  sched.maybe_schedule();
 }
 
 void TaskScheduler::tick() {
   auto current = Task::current();
+
+  // SCHED_FIFO tasks have no time slice. They run until they block or yield.
+  if (current->get_policy() == SCHED_FIFO) {
+    return;
+  }
+
   current->tick();
 
   if (current->get_time_slice() <= 0) {
-    _need_reschedule = true;
+    set_need_resched();
+  }
+}
+
+void TaskScheduler::update_tick() {
+  if (!exception::is_activated()) [[unlikely]] {
+    return;
+  }
+
+  TimerMultiplexer::the().reprogram(is_tick_needed(*Task::current()));
+}
+
+size_t TaskScheduler::get_nr_rt_wakeups() const {
+  return _nr_rt_wakeups.load(MemoryOrder::RELAXED);
+}
+
+size_t TaskScheduler::get_last_rt_wakeup_latency_ns() const {
+  return ARMCoreTimer::counter_to_ns(_last_rt_wakeup_latency);
+}
+
+size_t TaskScheduler::get_max_rt_wakeup_latency_ns() const {
+  return ARMCoreTimer::counter_to_ns(_max_rt_wakeup_latency);
+}
+
+size_t TaskScheduler::get_uptime_ns() const {
+  return ARMCoreTimer::counter_to_ns(ARMCoreTimer::get_counter() - _start_timestamp);
+}
+
+size_t TaskScheduler::get_idle_time_ns() const {
+  uint64_t idle_time = _idle_time.load(MemoryOrder::RELAXED);
+
+  // Include the current idle period as well.
+  if (Task::current() == _idle_task.get()) {
+    idle_time += ARMCoreTimer::get_counter() - _idle_enter_timestamp;
+  }
+
+  return ARMCoreTimer::counter_to_ns(idle_time);
+}
+
+size_t TaskScheduler::get_nr_idle_entries() const {
+  return _nr_idle_entries.load(MemoryOrder::RELAXED);
+}
+
+size_t TaskScheduler::get_nr_kernel_preemptions() const {
+  return _nr_kernel_preemptions.load(MemoryOrder::RELAXED);
+}
+
+List<UniquePtr<Task>> &TaskScheduler::get_runqueue(const Task &task) {
+  return task.is_rt_task() ? _rt_runqueues[task.get_rt_priority()] : _runqueue;
+}
+
+Task *TaskScheduler::pick_next_task() {
+  // Finding the highest non-empty rt priority is a single bitmap scan,
+  // so picking the next task costs O(1) regardless of the number of tasks.
+  if (size_t prio = _rt_bitmap.find_last_set(); prio != Bitmap<MAX_RT_PRIO>::npos) {
+    return _rt_runqueues[prio].front().get();
+  }
+
+  return (!_runqueue.empty()) ? _runqueue.front().get() : _idle_task.get();
+}
+
+void TaskScheduler::requeue_task(const Task &task) {
+  auto &runqueue = get_runqueue(task);
+
+  if (runqueue.size() <= 1 || runqueue.front().get() != &task) {
+    return;
+  }
+
+  auto t = move(runqueue.front());
+  runqueue.pop_front();
+  runqueue.push_back(move(t));
+}
+
+void TaskScheduler::switch_to_next_task() {
+  Task *prev = Task::current();
+  Task *next = pick_next_task();
+
+  if (!next) [[unlikely]] {
+    Kernel::panic("sched: no runnable task\n");
+  }
+
+  if (next->_wakeup_timestamp) {
+    account_rt_wakeup_latency(*next);
+  }
+
+#ifdef DEBUG
+  printf(">>>> context switch: next: pid = %d [%s], SP = 0x%p\n", next->get_pid(),
+         next->get_name(), next->_context.sp);
+#endif
+
+  // A preempted task remains RUNNING (i.e., runnable). Only tasks that are
+  // blocked on a wait queue are SLEEPING.
+  next->set_state(Task::State::RUNNING);
+
+  // Stop the periodic tick if `next` won't have to share the CPU.
+  TimerMultiplexer::the().reprogram(is_tick_needed(*next));
+
+  if (prev != next) {
+    account_idle_time(prev, next);
+    RCU::the().note_quiescent_state();
   }
+
+  // IRQs stay disabled until `next` restores its own DAIF, so nothing can
+  // touch the runqueues before the switch completes. This relies on NR_CPUS
+  // being 1, since another core could otherwise pick `prev` right away.
+  _runqueue_lock.unlock();
+
+  if (prev != next) {
+    // The preempt count belongs to the task rather than to the core.
+    CpuBlock &cpu_block = this_cpu_block();
+    prev->_preempt_count = cpu_block.preempt_count;
+    cpu_block.preempt_count = next->_preempt_count;
+
+    // So does the hold on Kernel::mutex. `prev` may be going to sleep with it
+    // held, and `next` must neither inherit that nor restore prev's DAIF.
+    prev->_bkl_state = Kernel::mutex.exchange_holder_state(next->_bkl_state);
+
+    // Only trap FP/SIMD access if the registers hold someone else's state.
+    FpSimdContext::switch_to(next->_fpsimd_context);
+
+    switch_to(prev, next);
+  }
+}
+
+bool TaskScheduler::should_preempt_current(const Task &task) const {
+  // Nothing to preempt before the scheduler has been started.
+  if (!exception::is_activated()) [[unlikely]] {
+    return false;
+  }
+
+  Task *current = Task::current();
+
+  return current == _idle_task.get() || task.get_rt_priority() > current->get_rt_priority();
+}
+
+bool TaskScheduler::is_tick_needed(const Task &task) {
+  // The idle task and SCHED_FIFO tasks are never preempted by a tick.
+  if (&task == _idle_task.get() || task.get_policy() == SCHED_FIFO) {
+    return false;
+  }
+
+  // A task which is alone in its runqueue has no one to round-robin with.
+  // If a higher-priority task wakes up, it will preempt `task` anyway.
+  return get_runqueue(task).size() > 1;
+}
+
+void TaskScheduler::account_idle_time(const Task *prev, const Task *next) {
+  const uint64_t now = ARMCoreTimer::get_counter();
+
+  if (prev == _idle_task.get()) {
+    _idle_time.fetch_add(now - _idle_enter_timestamp, MemoryOrder::RELAXED);
+  }
+
+  if (next == _idle_task.get()) {
+    _idle_enter_timestamp = now;
+    _nr_idle_entries.fetch_add(1, MemoryOrder::RELAXED);
+  }
+}
+
+void TaskScheduler::account_rt_wakeup_latency(Task &task) {
+  uint64_t latency = ARMCoreTimer::get_counter() - task._wakeup_timestamp;
+  task._wakeup_timestamp = 0;
+
+  _nr_rt_wakeups.fetch_add(1, MemoryOrder::RELAXED);
+  _last_rt_wakeup_latency = latency;
+  _max_rt_wakeup_latency = max(_max_rt_wakeup_latency, latency);
 }
 
 }  // namespace valkyrie::kernel
@@ -0,0 +1,58 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include <proc/WaitQueue.h>
+
+#include <Mutex.h>
+
+#include <kernel/Kernel.h>
+#include <proc/Task.h>
+#include <proc/TaskScheduler.h>
+
+namespace valkyrie::kernel {
+
+WaitQueue::WaitQueue() : _tasks() {}
+
+WaitQueue::~WaitQueue() {
+  if (!_tasks.empty()) [[unlikely]] {
+    Kernel::panic("WaitQueue: destroyed with %d sleeping tasks\n", _tasks.size());
+  }
+}
+
+void WaitQueue::sleep() {
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  auto &sched = TaskScheduler::the();
+  Task *current = Task::current();
+
+  current->set_state(Task::State::SLEEPING);
+  _tasks.push_back(sched.remove_task(*current));
+
+  // We'll return from here once wake_up() puts us back on the runqueue,
+  // still holding Kernel::mutex. Other tasks run without it meanwhile.
+  sched.schedule();
+}
+
+void WaitQueue::wake_up() {
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  if (_tasks.empty()) {
+    return;
+  }
+
+  UniquePtr<Task> task = move(_tasks.front());
+  _tasks.pop_front();
+  TaskScheduler::the().enqueue_task(move(task));
+}
+
+void WaitQueue::wake_up_all() {
+  const LockGuard<RecursiveMutex> lock(Kernel::mutex);
+
+  while (!_tasks.empty()) {
+    wake_up();
+  }
+}
+
+bool WaitQueue::empty() const {
+  return _tasks.empty();
+}
+
+}  // namespace valkyrie::kernel
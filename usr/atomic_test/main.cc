@@ -0,0 +1,88 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// atomic_test - checks that an operation on an Atomic<int> touches only its
+// own 4 bytes, so that two of them can sit side by side (e.g., the refcounts
+// in SharedPtr's control block, or the words of a pthread_mutex_t).
+#include <atomic.h>
+#include <vlibc.h>
+
+#define NR_THREADS 4
+#define NR_ITERATIONS 1000
+
+#define SENTINEL 0x5a5a5a5a
+
+// `b` lives in the upper half of the 8 bytes that start at `a`,
+// which is where an 8-byte access to `a` would spill over.
+struct alignas(8) Pair {
+  Atomic<int> a;
+  Atomic<int> b;
+};
+
+static Pair pair;
+
+static void *increment(void *arg) {
+  Atomic<int> &counter = arg ? pair.b : pair.a;
+
+  for (int i = 0; i < NR_ITERATIONS; i++) {
+    counter.fetch_add(1);
+    if (i % 100 == 0) {
+      sched_yield();
+    }
+  }
+  return nullptr;
+}
+
+int main(int argc, char **argv) {
+  static_assert(sizeof(Pair) == 8, "Atomic<int> must be 4 bytes");
+
+  // Each operation on `a` must leave `b` alone.
+  pair.b.store(SENTINEL);
+
+  pair.a.store(-1);
+  assert(pair.a.load() == -1 && pair.b.load() == SENTINEL);
+  pair.a.store(1, MemoryOrder::RELAXED);
+  assert(pair.a.load(MemoryOrder::RELAXED) == 1 && pair.b.load() == SENTINEL);
+
+  assert(pair.a.exchange(2) == 1 && pair.b.load() == SENTINEL);
+
+  int expected = 2;
+  assert(pair.a.compare_exchange(expected, 3) && pair.b.load() == SENTINEL);
+  expected = 2;
+  assert(!pair.a.compare_exchange(expected, 4) && expected == 3);
+  assert(pair.b.load() == SENTINEL);
+
+  assert(pair.a.fetch_add(10) == 3 && pair.b.load() == SENTINEL);
+  assert(pair.a.fetch_sub(20) == 13 && pair.a.load() == -7);
+  assert(pair.b.load() == SENTINEL);
+
+  pair.a.store(0);
+  assert(pair.a.fetch_or(0xf0) == 0 && pair.b.load() == SENTINEL);
+  assert(pair.a.fetch_and(0x30) == 0xf0 && pair.a.load() == 0x30);
+  assert(pair.b.load() == SENTINEL);
+
+  // The other way around, with a negative value whose sign bits would
+  // spill over into `a`.
+  pair.a.store(0);
+  pair.b.store(-1);
+  assert(pair.a.load() == 0);
+
+  // Two threads bumping the neighbours at the same time must not lose
+  // each other's updates.
+  pair.a.store(0);
+  pair.b.store(0);
+
+  pthread_t threads[NR_THREADS];
+
+  for (long i = 0; i < NR_THREADS; i++) {
+    assert(pthread_create(&threads[i], nullptr, increment, reinterpret_cast<void *>(i % 2)) ==
+           0);
+  }
+  for (int i = 0; i < NR_THREADS; i++) {
+    assert(pthread_join(threads[i], nullptr) == 0);
+  }
+  assert(pair.a.load() == NR_THREADS / 2 * NR_ITERATIONS);
+  assert(pair.b.load() == NR_THREADS / 2 * NR_ITERATIONS);
+
+  printf("atomic_test: OK\n");
+  return 0;
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// dup_test - checks that a process can open more files than the initial
+// size of its fd table, that the lowest free fd is always handed out, and
+// that the fds created by dup(), dup2() and fork() share the file offset.
+#include <vlibc.h>
+
+#define O_CREAT ((1 << 3))
+#define NR_FILES 40
+#define PATHNAME "/dev/dup_test"
+
+static int read_char(int fd) {
+  char c = 0;
+  return (read(fd, &c, 1) == 1) ? c : -1;
+}
+
+int main(int argc, char **argv) {
+  int fds[NR_FILES];
+
+  int fd = open(PATHNAME, O_CREAT);
+  assert(fd >= 0);
+  assert(write(fd, "0123456789", 10) == 10);
+  assert(close(fd) == 0);
+
+  // More fds than the fd table initially has room for.
+  for (int i = 0; i < NR_FILES; i++) {
+    fds[i] = open(PATHNAME, 0);
+    assert(fds[i] >= 0);
+    assert(i == 0 || fds[i] == fds[i - 1] + 1);
+  }
+
+  // The lowest free fd is reused.
+  int hole = fds[NR_FILES / 2];
+  assert(close(hole) == 0);
+  assert((fds[NR_FILES / 2] = open(PATHNAME, 0)) == hole);
+
+  for (int i = 1; i < NR_FILES; i++) {
+    assert(close(fds[i]) == 0);
+  }
+  fd = fds[0];
+
+  // Each open() has an offset of its own...
+  int other = open(PATHNAME, 0);
+  assert(read_char(fd) == '0');
+  assert(read_char(other) == '0');
+  assert(close(other) == 0);
+
+  // ...but a dup()'ed fd shares it.
+  int copy = dup(fd);
+  assert(copy == fd + 1);
+  assert(read_char(copy) == '1');
+  assert(read_char(fd) == '2');
+
+  // So does a dup2()'ed fd, even beyond the current end of the table.
+  assert(dup2(fd, NR_FILES + 10) == NR_FILES + 10);
+  assert(read_char(NR_FILES + 10) == '3');
+  assert(dup2(fd, fd) == fd);
+  assert(dup2(NR_FILES + 20, fd) == -1);
+  assert(close(NR_FILES + 10) == 0);
+
+  // A forked child inherits the open file descriptions.
+  int pid = fork();
+  assert(pid >= 0);
+
+  if (pid == 0) {
+    assert(read_char(copy) == '4');
+    exit(0);
+  }
+
+  int wstatus = 0;
+  assert(waitpid(pid, &wstatus, 0) == pid);
+  assert(read_char(fd) == '5');
+
+  assert(close(copy) == 0);
+  assert(close(fd) == 0);
+
+  printf("dup_test: OK\n");
+  return 0;
+}
@@ -0,0 +1,34 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// fat32_path_test - checks that ".." of a top-level directory of the
+// FAT32 rootfs is the root directory itself.
+//
+// On disk, that ".." refers to the root directory by a first cluster number
+// of 0. If it came out as a copy of the root directory rather than the root
+// inode, it would lack the "." and ".." which only the root inode fakes, and
+// the mounts on the root directory's children would be bypassed.
+#include <vlibc.h>
+
+int main(int argc, char **argv) {
+  assert(access("/sbin/..", 0) == 0);
+  assert(access("/sbin/../..", 0) == 0);
+  assert(access("/sbin/../sbin/../sbin/ls", 0) == 0);
+
+  // /proc is a mountpoint on the root directory.
+  int fd = open("/sbin/../proc/stat", 0);
+  assert(fd >= 0);
+
+  char buf[16];
+  int sz = read(fd, buf, sizeof(buf) - 1);
+  assert(sz > 0);
+  buf[sz] = '\0';
+  close(fd);
+  printf("/sbin/../proc/stat: %s...\n", buf);
+
+  assert(chdir("/sbin/..") == 0);
+  assert(access("sbin/ls", 0) == 0);
+  assert(access("../sbin/ls", 0) == 0);
+
+  printf("fat32 path test passed successfully\n");
+  return 0;
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// fat32_read_test - checks that reading a large file from the SD card
+// is done with IRQs unmasked, i.e., that it can be preempted.
+//
+// FAT32 counts the reads it issues with DAIF.I set in /proc/stat. Reading
+// a file which isn't open elsewhere (so it isn't in the page cache) must
+// go to the disk, and must not add to that count.
+//
+// Usage: fat32_read_test [path]   (default: /sbin/ls)
+#include <cstring.h>
+#include <vlibc.h>
+
+#define BUF_SIZE (64 * 1024)
+
+static unsigned long get_stat(const char *name) {
+  char buf[256];
+  int fd = open("/proc/stat", 0);
+  assert(fd >= 0);
+
+  int sz = read(fd, buf, sizeof(buf) - 1);
+  assert(sz > 0);
+  buf[sz] = '\0';
+  close(fd);
+
+  const char *field = strstr(buf, name);
+  assert(field);
+  return atoi(field + strlen(name));
+}
+
+int main(int argc, char **argv) {
+  const char *path = (argc > 1) ? argv[1] : "/sbin/ls";
+  void *addr = reinterpret_cast<void *>(0x10000000);
+  char *buf = (char *) mmap(addr, BUF_SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS, -1, 0);
+  assert(buf == addr);
+
+  unsigned long nr_reads = get_stat("fat32_disk_reads: ");
+  unsigned long nr_irqs_off_reads = get_stat("fat32_irqs_off_disk_reads: ");
+
+  int fd = open(path, 0);
+  assert(fd >= 0);
+
+  int total = 0;
+  int sz;
+  while ((sz = read(fd, buf, BUF_SIZE)) > 0) {
+    total += sz;
+  }
+  close(fd);
+
+  unsigned long nr_reads_after = get_stat("fat32_disk_reads: ");
+  unsigned long nr_irqs_off_reads_after = get_stat("fat32_irqs_off_disk_reads: ");
+
+  printf("read %d bytes from %s: %lu disk reads, %lu with IRQs masked\n", total, path,
+         nr_reads_after - nr_reads, nr_irqs_off_reads_after - nr_irqs_off_reads);
+  assert(total > 0);
+  assert(nr_reads_after > nr_reads);
+  assert(nr_irqs_off_reads_after == nr_irqs_off_reads);
+
+  munmap(buf, BUF_SIZE);
+  printf("fat32 read test passed successfully\n");
+  return 0;
+}
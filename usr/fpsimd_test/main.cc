@@ -0,0 +1,48 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// fpsimd_test - checks that the FP/SIMD registers survive context switches.
+//
+// Several processes each put their own pattern in d8, give up the CPU
+// over and over again, and then check that d8 still holds their pattern.
+// d8 is callee-saved under AAPCS64, so sched_yield() and the code around
+// it may not legally clobber it; only a broken context switch could.
+#include <vlibc.h>
+
+#define NR_PROCESSES 4
+#define NR_YIELDS 100
+
+static bool test(uint64_t pattern) {
+  uint64_t result;
+
+  asm volatile("fmov d8, %0" ::"r"(pattern) : "v8");
+
+  for (int i = 0; i < NR_YIELDS; i++) {
+    sched_yield();
+  }
+
+  asm volatile("fmov %0, d8" : "=r"(result));
+  return result == pattern;
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < NR_PROCESSES; i++) {
+    if (fork() == 0) {
+      break;
+    }
+  }
+
+  const uint64_t pattern = 0x0123456789abcdef ^ getpid();
+
+  if (test(pattern)) {
+    printf("pid %d: OK\n", getpid());
+  } else {
+    printf("pid %d: FP/SIMD state was clobbered!\n", getpid());
+  }
+
+  int wstatus;
+  while (wait(&wstatus) != -1) {
+    ;
+  }
+
+  return 0;
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// futex_test - checks that the futex-based pthread mutex keeps threads
+// out of each other's critical sections, and that condition variables
+// wake up their waiters on pthread_cond_signal() and pthread_cond_broadcast().
+#include <vlibc.h>
+
+#define NR_THREADS 4
+#define NR_ITERATIONS 1000
+#define NR_ITEMS 100
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t start = PTHREAD_COND_INITIALIZER;
+
+static long counter;
+static int queue_len;
+static long queue_sum;
+static bool started;
+
+static void *increment(void *arg) {
+  for (int i = 0; i < NR_ITERATIONS; i++) {
+    pthread_mutex_lock(&mutex);
+
+    // Yield in the middle of the critical section every now and then,
+    // so that the others find the mutex locked and have to sleep on it.
+    long value = counter;
+    if (i % 100 == 0) {
+      sched_yield();
+    }
+    counter = value + 1;
+
+    pthread_mutex_unlock(&mutex);
+  }
+  return nullptr;
+}
+
+static void *produce(void *arg) {
+  for (int i = 1; i <= NR_ITEMS; i++) {
+    pthread_mutex_lock(&mutex);
+    while (queue_len == 1) {
+      pthread_cond_wait(&not_full, &mutex);
+    }
+    queue_len++;
+    queue_sum += i;
+    pthread_cond_signal(&not_empty);
+    pthread_mutex_unlock(&mutex);
+  }
+  return nullptr;
+}
+
+static void *wait_for_start(void *arg) {
+  pthread_mutex_lock(&mutex);
+  while (!started) {
+    pthread_cond_wait(&start, &mutex);
+  }
+  counter++;
+  pthread_mutex_unlock(&mutex);
+  return nullptr;
+}
+
+int main(int argc, char **argv) {
+  pthread_t threads[NR_THREADS];
+
+  // Mutual exclusion
+  for (int i = 0; i < NR_THREADS; i++) {
+    assert(pthread_create(&threads[i], nullptr, increment, nullptr) == 0);
+  }
+  for (int i = 0; i < NR_THREADS; i++) {
+    assert(pthread_join(threads[i], nullptr) == 0);
+  }
+  assert(counter == NR_THREADS * NR_ITERATIONS);
+
+  // pthread_cond_signal(): a single-slot queue between two threads.
+  long sum = 0;
+  assert(pthread_create(&threads[0], nullptr, produce, nullptr) == 0);
+
+  for (int i = 1; i <= NR_ITEMS; i++) {
+    pthread_mutex_lock(&mutex);
+    while (queue_len == 0) {
+      pthread_cond_wait(&not_empty, &mutex);
+    }
+    queue_len--;
+    sum = queue_sum;
+    pthread_cond_signal(&not_full);
+    pthread_mutex_unlock(&mutex);
+  }
+  assert(pthread_join(threads[0], nullptr) == 0);
+  assert(sum == NR_ITEMS * (NR_ITEMS + 1) / 2);
+
+  // pthread_cond_broadcast(): all the waiters must get through.
+  counter = 0;
+  for (int i = 0; i < NR_THREADS; i++) {
+    assert(pthread_create(&threads[i], nullptr, wait_for_start, nullptr) == 0);
+  }
+
+  pthread_mutex_lock(&mutex);
+  started = true;
+  pthread_cond_broadcast(&start);
+  pthread_mutex_unlock(&mutex);
+
+  for (int i = 0; i < NR_THREADS; i++) {
+    assert(pthread_join(threads[i], nullptr) == 0);
+  }
+  assert(counter == NR_THREADS);
+
+  printf("futex_test: OK\n");
+  return 0;
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// mmap_private_test - checks that writing through a file-backed mapping
+// leaves the file alone.
+//
+// The mapping shares its page frames with the page cache until it's written
+// to, so a write that went into the shared frame would show up in read().
+#include <cstring.h>
+#include <vlibc.h>
+
+#define O_CREAT ((1 << 3))
+
+static const char path[] = "mmap_private_test.txt";
+static const char content[] = "The quick brown fox jumps over the lazy dog";
+
+int main(int argc, char **argv) {
+  char buf[64];
+
+  int fd = open(path, O_CREAT);
+  assert(fd >= 0);
+  assert(write(fd, content, sizeof(content)) == sizeof(content));
+  close(fd);
+
+  fd = open(path, 0);
+  assert(fd >= 0);
+
+  void *addr = reinterpret_cast<void *>(0x10000000);
+  char *ptr = (char *) mmap(addr, 4096, PROT_READ | PROT_WRITE, 0, fd, 0);
+  assert(ptr == addr);
+  assert(memcmp(ptr, content, sizeof(content)) == 0);
+
+  // The rest of the page, past EOF, is zero-filled.
+  for (int i = sizeof(content); i < 4096; i++) {
+    assert(ptr[i] == 0);
+  }
+
+  memset(ptr, 'x', sizeof(content) - 1);
+  assert(ptr[0] == 'x');
+
+  // Neither the page cache nor the file may have seen the write.
+  assert(read(fd, buf, sizeof(buf)) == sizeof(content));
+  assert(memcmp(buf, content, sizeof(content)) == 0);
+  close(fd);
+
+  fd = open(path, 0);
+  assert(fd >= 0);
+  assert(read(fd, buf, sizeof(buf)) == sizeof(content));
+  assert(memcmp(buf, content, sizeof(content)) == 0);
+  close(fd);
+
+  munmap(ptr, 4096);
+  unlink(path);
+  printf("mmap private test passed successfully\n");
+  return 0;
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// preempt_test - checks that a reschedule which becomes pending inside a
+// Kernel::mutex section is carried out as soon as the section ends.
+//
+// A SCHED_FIFO thread sleeps on a futex, and we wake it up. The wakeup
+// happens with Kernel::mutex held, so the switch to the rt thread has to
+// wait for the outermost unlock, which counts it in /proc/schedstat.
+#include <cstring.h>
+#include <vlibc.h>
+
+static int futex_word;
+static volatile bool ready;
+static volatile bool woken;
+
+static unsigned long get_nr_kernel_preemptions() {
+  char buf[256];
+  int fd = open("/proc/schedstat", 0);
+  assert(fd >= 0);
+
+  int sz = read(fd, buf, sizeof(buf) - 1);
+  assert(sz > 0);
+  buf[sz] = '\0';
+  close(fd);
+
+  const char *field = strstr(buf, "kernel_preemptions: ");
+  assert(field);
+  return atoi(field + strlen("kernel_preemptions: "));
+}
+
+static void *rt_thread(void *arg) {
+  struct sched_param param = {50};
+  assert(sched_setscheduler(0, SCHED_FIFO, &param) == 0);
+
+  // From here on, the main thread only runs while we're asleep.
+  ready = true;
+  while (futex_word == 0) {
+    futex(&futex_word, FUTEX_WAIT, 0, nullptr, 0);
+  }
+  woken = true;
+  return nullptr;
+}
+
+int main(int argc, char **argv) {
+  pthread_t thread;
+
+  assert(pthread_create(&thread, nullptr, rt_thread, nullptr) == 0);
+  while (!ready) {
+    sched_yield();
+  }
+
+  unsigned long before = get_nr_kernel_preemptions();
+  futex_word = 1;
+  futex(&futex_word, FUTEX_WAKE, 1, nullptr, 0);
+
+  // The rt thread must have run before futex() returned to us.
+  assert(woken);
+  unsigned long after = get_nr_kernel_preemptions();
+  printf("kernel preemptions: %lu -> %lu\n", before, after);
+  assert(after > before);
+
+  assert(pthread_join(thread, nullptr) == 0);
+  printf("preempt test passed successfully\n");
+  return 0;
+}
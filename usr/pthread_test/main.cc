@@ -0,0 +1,46 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// pthread_test - checks that threads share one address space, and that
+// each of them has a stack and a TLS pointer of its own.
+#include <vlibc.h>
+
+#define NR_THREADS 4
+
+static int results[NR_THREADS];
+
+static void *worker(void *arg) {
+  long i = reinterpret_cast<long>(arg);
+  int sum = 0;
+
+  for (int j = 0; j <= 100; j++) {
+    sum += j;
+    if (j % 10 == 0) {
+      sched_yield();
+    }
+  }
+
+  results[i] = sum + i;
+  return pthread_self();
+}
+
+int main(int argc, char **argv) {
+  pthread_t threads[NR_THREADS];
+
+  for (long i = 0; i < NR_THREADS; i++) {
+    assert(pthread_create(&threads[i], nullptr, worker, reinterpret_cast<void *>(i)) == 0);
+  }
+
+  for (int i = 0; i < NR_THREADS; i++) {
+    void *retval;
+    assert(pthread_join(threads[i], &retval) == 0);
+
+    // Each thread sees itself through its own TLS pointer.
+    assert(retval == threads[i]);
+
+    // ... and writes to the same memory as we do.
+    assert(results[i] == 5050 + i);
+  }
+
+  printf("pthread_test: %d threads OK\n", NR_THREADS);
+  return 0;
+}
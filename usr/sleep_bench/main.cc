@@ -0,0 +1,83 @@
+// Copyright (c) 2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+//
+// sleep_bench - measures how accurately nanosleep() wakes us up.
+//
+// For each requested duration, sleeps NR_SAMPLES times and reports the
+// distribution of the overshoot, i.e., (actual - requested) sleep time.
+// Run `sleep_bench rt` to measure as a SCHED_FIFO task (no timer slack).
+#include <vlibc.h>
+
+#define NR_SAMPLES 20
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+// Overshoot histogram buckets, in microseconds.
+static const uint64_t bucket_limits_us[] = {10, 50, 100, 500, 1000, 10000};
+static constexpr int nr_buckets = sizeof(bucket_limits_us) / sizeof(bucket_limits_us[0]) + 1;
+
+static void bench(uint64_t requested_ns) {
+  uint64_t min_ns = -1;
+  uint64_t max_ns = 0;
+  uint64_t total_ns = 0;
+  int histogram[nr_buckets] = {};
+
+  for (int i = 0; i < NR_SAMPLES; i++) {
+    struct timespec req = {requested_ns / NSEC_PER_SEC, (long) (requested_ns % NSEC_PER_SEC)};
+
+    uint64_t begin = now_ns();
+    nanosleep(&req, nullptr);
+    uint64_t actual_ns = now_ns() - begin;
+
+    if (actual_ns < requested_ns) {
+      printf("woke up early! requested %lu ns, slept %lu ns\n", requested_ns, actual_ns);
+      continue;
+    }
+
+    uint64_t overshoot_ns = actual_ns - requested_ns;
+    min_ns = (overshoot_ns < min_ns) ? overshoot_ns : min_ns;
+    max_ns = (overshoot_ns > max_ns) ? overshoot_ns : max_ns;
+    total_ns += overshoot_ns;
+
+    int bucket = 0;
+    while (bucket < nr_buckets - 1 && overshoot_ns / 1000 >= bucket_limits_us[bucket]) {
+      bucket++;
+    }
+    histogram[bucket]++;
+  }
+
+  printf("requested %lu us: overshoot min %lu us, avg %lu us, max %lu us\n",
+         requested_ns / 1000, min_ns / 1000, total_ns / NR_SAMPLES / 1000, max_ns / 1000);
+
+  for (int i = 0; i < nr_buckets; i++) {
+    if (i < nr_buckets - 1) {
+      printf("  < %lu us: %d\n", bucket_limits_us[i], histogram[i]);
+    } else {
+      printf("  >= %lu us: %d\n", bucket_limits_us[i - 1], histogram[i]);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && argv[1][0] == 'r') {
+    struct sched_param param = {50};
+    assert(sched_setscheduler(0, SCHED_FIFO, &param) == 0);
+    printf("running as SCHED_FIFO\n");
+  }
+
+  const uint64_t durations_ns[] = {
+      100000,     // 100 us
+      1000000,    // 1 ms
+      10000000,   // 10 ms
+      100000000,  // 100 ms
+  };
+
+  for (auto duration_ns : durations_ns) {
+    bench(duration_ns);
+  }
+
+  return 0;
+}
@@ -12,3 +12,197 @@ extern "C" [[noreturn]] void _start() {
 extern "C" [[noreturn]] void __restore_rt() {
   sigreturn();
 }
+
+// The vdata page exported by the kernel. See include/kernel/Clock.h
+#define USER_VDATA_PAGE 0x00007fffffffd000
+
+struct vdata_page {
+  volatile uint32_t seq;
+  uint32_t reserved;
+  uint64_t cntfrq;
+  uint64_t realtime_offset_ns;
+};
+
+extern "C" int clock_gettime(clockid_t clockid, struct timespec *tp) {
+  if (clockid != CLOCK_REALTIME && clockid != CLOCK_MONOTONIC) {
+    return __sys_clock_gettime(clockid, tp);
+  }
+
+  auto vdata = reinterpret_cast<const vdata_page *>(USER_VDATA_PAGE);
+  uint32_t seq;
+  uint64_t cntfrq;
+  uint64_t offset;
+  uint64_t cntpct;
+
+  // Retry if the kernel has updated the vdata page in the meantime.
+  do {
+    seq = vdata->seq;
+    asm volatile("dmb ishld" ::: "memory");
+    cntfrq = vdata->cntfrq;
+    offset = (clockid == CLOCK_REALTIME) ? vdata->realtime_offset_ns : 0;
+    asm volatile("isb; mrs %0, cntpct_el0" : "=r"(cntpct));
+    asm volatile("dmb ishld" ::: "memory");
+  } while ((seq & 1) || seq != vdata->seq);
+
+  uint64_t ns = (cntpct / cntfrq) * NSEC_PER_SEC + (cntpct % cntfrq) * NSEC_PER_SEC / cntfrq;
+  ns += offset;
+
+  tp->tv_sec = ns / NSEC_PER_SEC;
+  tp->tv_nsec = ns % NSEC_PER_SEC;
+  return 0;
+}
+
+static int pthread_start(void *arg) {
+  auto self = static_cast<pthread_t>(arg);
+  self->retval = self->start_routine(self->arg);
+  return 0;
+}
+
+extern "C" int pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                              void *(*start_routine)(void *), void *arg) {
+  char *stack = static_cast<char *>(
+      mmap(nullptr, PTHREAD_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS, -1, 0));
+
+  if (stack == reinterpret_cast<char *>(-1)) {
+    return -1;
+  }
+
+  // Put the thread control block at the top of the stack.
+  auto self = reinterpret_cast<pthread_t>(stack + PTHREAD_STACK_SIZE) - 1;
+  self->tid = 0;
+  self->start_routine = start_routine;
+  self->arg = arg;
+  self->retval = nullptr;
+
+  // The stack grows downwards from right below it, and it must be 16-byte aligned.
+  void *sp = reinterpret_cast<void *>(reinterpret_cast<size_t>(self) & ~0xfUL);
+  int flags = CLONE_VM | CLONE_FILES | CLONE_SIGHAND | CLONE_SETTLS;
+  int tid = clone(pthread_start, sp, flags, self, self);
+
+  if (tid < 0) {
+    // XXX: `stack` is leaked as well, see pthread_join().
+    return -1;
+  }
+
+  self->tid = tid;
+  *thread = self;
+  return 0;
+}
+
+extern "C" int pthread_join(pthread_t thread, void **retval) {
+  if (waitpid(thread->tid, nullptr, 0) == -1) {
+    return -1;
+  }
+
+  if (retval) {
+    *retval = thread->retval;
+  }
+
+  // XXX: The thread's stack is leaked, since munmap() isn't implemented yet.
+  return 0;
+}
+
+extern "C" [[noreturn]] void pthread_exit(void *retval) {
+  if (pthread_t self = pthread_self()) {
+    self->retval = retval;
+  }
+  exit(0);
+}
+
+extern "C" pthread_t pthread_self() {
+  pthread_t self;
+  asm volatile("mrs %0, tpidr_el0" : "=r"(self));
+  return self;
+}
+
+static int *futex_word(Atomic<int> &word) {
+  return reinterpret_cast<int *>(&word);
+}
+
+// Locks `mutex` for someone who may have just been woken up by a futex,
+// marking it contended since others may still be asleep on it.
+static void pthread_mutex_lock_contended(pthread_mutex_t *mutex) {
+  while (mutex->state.exchange(2, MemoryOrder::ACQUIRE) != 0) {
+    futex(futex_word(mutex->state), FUTEX_WAIT, 2, nullptr, 0);
+  }
+}
+
+extern "C" int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr) {
+  mutex->state.store(0, MemoryOrder::RELAXED);
+  return 0;
+}
+
+extern "C" int pthread_mutex_destroy(pthread_mutex_t *mutex) {
+  return 0;
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t *mutex) {
+  int state = 0;
+
+  if (mutex->state.compare_exchange(state, 1, MemoryOrder::ACQUIRE)) {
+    return 0;
+  }
+
+  pthread_mutex_lock_contended(mutex);
+  return 0;
+}
+
+extern "C" int pthread_mutex_trylock(pthread_mutex_t *mutex) {
+  int state = 0;
+  return mutex->state.compare_exchange(state, 1, MemoryOrder::ACQUIRE) ? 0 : -1;
+}
+
+extern "C" int pthread_mutex_unlock(pthread_mutex_t *mutex) {
+  // Only enter the kernel if someone may be asleep on it.
+  if (mutex->state.exchange(0, MemoryOrder::RELEASE) == 2) {
+    futex(futex_word(mutex->state), FUTEX_WAKE, 1, nullptr, 0);
+  }
+  return 0;
+}
+
+extern "C" int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr) {
+  cond->seq.store(0, MemoryOrder::RELAXED);
+  cond->mutex.store(nullptr, MemoryOrder::RELAXED);
+  return 0;
+}
+
+extern "C" int pthread_cond_destroy(pthread_cond_t *cond) {
+  return 0;
+}
+
+extern "C" int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
+  // Read before unlocking the mutex, so that a signal sent in between
+  // changes it and keeps us from going to sleep.
+  int seq = cond->seq.load(MemoryOrder::RELAXED);
+  cond->mutex.store(mutex, MemoryOrder::RELAXED);
+
+  pthread_mutex_unlock(mutex);
+  futex(futex_word(cond->seq), FUTEX_WAIT, seq, nullptr, 0);
+
+  // pthread_cond_broadcast() may have moved us onto the mutex, and then only
+  // an unlock of a contended mutex would wake up whoever is still there.
+  pthread_mutex_lock_contended(mutex);
+  return 0;
+}
+
+extern "C" int pthread_cond_signal(pthread_cond_t *cond) {
+  cond->seq.fetch_add(1, MemoryOrder::RELEASE);
+  futex(futex_word(cond->seq), FUTEX_WAKE, 1, nullptr, 0);
+  return 0;
+}
+
+extern "C" int pthread_cond_broadcast(pthread_cond_t *cond) {
+  pthread_mutex_t *mutex = cond->mutex.load(MemoryOrder::RELAXED);
+  cond->seq.fetch_add(1, MemoryOrder::RELEASE);
+
+  // No one has ever waited on it.
+  if (!mutex) {
+    return 0;
+  }
+
+  // Wake up only one waiter, and move the rest onto the mutex, where they
+  // would have to wait for each other anyway, instead of having them all
+  // wake up at once just to fight over it.
+  futex(futex_word(cond->seq), FUTEX_REQUEUE, 1, futex_word(mutex->state), 0x7fffffff);
+  return 0;
+}
@@ -2,6 +2,7 @@
 #ifndef VALKYRIE_LIBC_H_
 #define VALKYRIE_LIBC_H_
 
+#include <atomic.h>
 #include <printf.h>
 #include <types.h>
 
@@ -20,6 +21,74 @@
 
 #define SIGSEGV 11
 
+// clone() flags
+#define CLONE_VM 0x00000100      /* Share the address space. */
+#define CLONE_FILES 0x00000400   /* Share the fd table. */
+#define CLONE_SIGHAND 0x00000800 /* Share the signal handlers (requires CLONE_VM). */
+#define CLONE_SETTLS 0x00080000  /* Set the TLS pointer (TPIDR_EL0). */
+
+// futex() operations
+#define FUTEX_WAIT 0    /* Sleep if *uaddr == val. */
+#define FUTEX_WAKE 1    /* Wake up at most `val` waiters. */
+#define FUTEX_REQUEUE 3 /* Wake up `val` waiters, move `val2` others to uaddr2. */
+
+// The stack size of each thread created by pthread_create().
+#define PTHREAD_STACK_SIZE (16 * 4096)
+
+// sched_setscheduler() policies
+#define SCHED_NORMAL 0 /* Time-sharing round-robin. */
+#define SCHED_FIFO 1   /* Real-time, runs until it blocks or yields. */
+#define SCHED_RR 2     /* Real-time, round-robin among equal priorities. */
+
+struct sched_param {
+  int sched_priority;
+};
+
+// clock_gettime() clock ids
+#define CLOCK_REALTIME 0
+#define CLOCK_MONOTONIC 1
+
+#define NSEC_PER_SEC 1000000000
+
+using clockid_t = int;
+
+struct timespec {
+  time_t tv_sec;
+  long tv_nsec;
+};
+
+// The thread control block lives at the top of the thread's stack,
+// and TPIDR_EL0 points to it.
+struct __pthread {
+  pid_t tid;
+  void *(*start_routine)(void *);
+  void *arg;
+  void *retval;
+};
+
+using pthread_t = struct __pthread *;
+using pthread_attr_t = void;
+
+// A futex-based mutex. The state is 0 if it's unlocked, 1 if it's locked,
+// and 2 if it's locked and someone may be sleeping on it, in which case
+// pthread_mutex_unlock() has to enter the kernel to wake them up.
+struct pthread_mutex_t {
+  Atomic<int> state;
+};
+
+// A futex-based condition variable. Every signal bumps the sequence number,
+// so a waiter which has been signaled before it could go to sleep doesn't.
+struct pthread_cond_t {
+  Atomic<int> seq;
+  Atomic<pthread_mutex_t *> mutex;  // the mutex last used with it
+};
+
+using pthread_mutexattr_t = void;
+using pthread_condattr_t = void;
+
+#define PTHREAD_MUTEX_INITIALIZER {}
+#define PTHREAD_COND_INITIALIZER {}
+
 #define assert(pred)                \
   do {                              \
     if (!(pred)) {                  \
@@ -54,6 +123,40 @@ int getcwd(char *buf);
 void *mmap(void *addr, size_t len, int prot, int flags, int fd, int file_offset);
 int munmap(void *addr, size_t len);
 int sigreturn();
+int sched_setscheduler(pid_t pid, int policy, const struct sched_param *param);
+int __sys_clock_gettime(clockid_t clockid, struct timespec *tp);
+
+// Reads the clock from the vdata page without a system call.
+int clock_gettime(clockid_t clockid, struct timespec *tp);
+int nanosleep(const struct timespec *req, struct timespec *rem);
+int waitpid(pid_t pid, int *wstatus, int options);
+int futex(int *uaddr, int op, int val, int *uaddr2, int val2);
+int dup(int oldfd);
+int dup2(int oldfd, int newfd);
+
+// Runs `fn(arg)` in a new task on `stack`, and exits with its return value.
+int clone(int (*fn)(void *), void *stack, int flags, void *arg, void *tls);
+
+// POSIX threads (minimal)
+// The main thread isn't created by pthread_create(), so its pthread_self() is null.
+int pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                   void *(*start_routine)(void *), void *arg);
+int pthread_join(pthread_t thread, void **retval);
+[[noreturn]] void pthread_exit(void *retval);
+pthread_t pthread_self();
+
+// Neither of these enters the kernel unless it has to sleep or wake someone up.
+int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
+int pthread_mutex_destroy(pthread_mutex_t *mutex);
+int pthread_mutex_lock(pthread_mutex_t *mutex);
+int pthread_mutex_trylock(pthread_mutex_t *mutex);
+int pthread_mutex_unlock(pthread_mutex_t *mutex);
+
+int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr);
+int pthread_cond_destroy(pthread_cond_t *cond);
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
+int pthread_cond_signal(pthread_cond_t *cond);
+int pthread_cond_broadcast(pthread_cond_t *cond);
 
 [[noreturn]] void __restore_rt();
 